@@ -0,0 +1,731 @@
+#include <atomic>
+#include <charconv>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <random>
+#include <string>
+#include <string_view>
+#include "include/orderbook.hpp"
+#include "include/latencyrecorder.hpp"
+#include "include/engine.hpp"
+#include "include/corelayout.hpp"
+#include "include/journal.hpp"
+#include "include/asyncwriter.hpp"
+#include "include/flowreplay.hpp"
+#include "include/bookloader.hpp"
+#include "include/booksnapshot.hpp"
+#include "include/session.hpp"
+#include "include/simulation.hpp"
+
+// Latency / throughput benchmarks for the headless matching API.
+// Build optimized (-DCMAKE_BUILD_TYPE=Release) and run:
+//   MultiTypeOrderbookBench [--seed N] [orders] [core layout, e.g. "matching=2-5;gateway=1;journal=0;marketdata=0"]
+// or, to push a recorded capture file (see flowreplay.hpp) through a book:
+//   MultiTypeOrderbookBench --replay FILE [--speed N]      (no speed: as fast as possible; 1: real time)
+// Every input is generated from the seed (default 42), so a run's input can be regenerated
+// exactly to compare builds.
+
+using Clock = LatencyRecorder::Clock;
+
+// One step of synthetic order flow
+struct FlowCommand {
+    enum class Kind { SUBMIT, CANCEL };
+
+    Kind         kind{Kind::SUBMIT};
+    OrderRequest request{};
+    std::size_t  cancelRef{0};      // CANCEL: index of an earlier SUBMIT in the flow
+};
+
+// Flow around `center`: passive limits near the touch, some marketable limits and market
+// orders, and cancels of recently submitted orders. Deterministic for a given seed.
+std::vector<FlowCommand> makeFlow(std::size_t count, Price center, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pct(0, 99);
+    std::uniform_int_distribution<Price> passiveOffset(1, 50);
+    std::uniform_int_distribution<Price> aggressiveOffset(0, 5);
+    std::uniform_int_distribution<Quantity> qty(1, 500);
+
+    std::vector<FlowCommand> flow;
+    flow.reserve(count);
+    std::size_t submitted = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        FlowCommand cmd;
+        const int roll = pct(rng);
+        const Side side = (rng() & 1) ? Side::BUY : Side::SELL;
+        const Price sign = (side == Side::BUY) ? -1 : 1;
+
+        if (roll < 35 && submitted > 0) {
+            cmd.kind = FlowCommand::Kind::CANCEL;
+            const std::size_t window = std::min<std::size_t>(submitted, 1000);
+            cmd.cancelRef = submitted - 1 - (rng() % window);
+        } else if (roll < 85) {
+            cmd.request = {side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, center + sign * passiveOffset(rng), qty(rng)};
+        } else if (roll < 95) {
+            cmd.request = {side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, center - sign * aggressiveOffset(rng), qty(rng)};
+        } else {
+            cmd.request = {side, OrderType::MARKET, TimeInForce::IMMEDIATE_OR_CANCEL, 0, qty(rng)};
+        }
+        if (cmd.kind == FlowCommand::Kind::SUBMIT) ++submitted;
+        flow.push_back(cmd);
+    }
+    return flow;
+}
+
+template <typename Book>
+void benchBook(std::string_view label, const std::vector<FlowCommand>& flow, Price center, Book& book) {
+    book.recenter(center);
+
+    std::vector<OrderID> ids;
+    ids.reserve(flow.size());
+    ExecutionReport report;
+    report.fills.reserve(256);
+    LatencyRecorder latency(flow.size());
+
+    const auto start = Clock::now();
+    for (const auto& cmd : flow) {
+        const auto t0 = Clock::now();
+        if (cmd.kind == FlowCommand::Kind::SUBMIT) {
+            book.submit(cmd.request, report);
+            ids.push_back(report.orderId);
+        } else {
+            book.cancel(ids[cmd.cancelRef]);
+        }
+        latency.record(Clock::now() - t0);
+    }
+    latency.print(label, Clock::now() - start);
+}
+
+template <typename Book>
+void benchBook(std::string_view label, const std::vector<FlowCommand>& flow, Price center) {
+    BookConfig config;
+    config.orderCapacity = flow.size();
+    Book book(config);
+    benchBook(label, flow, center, book);
+}
+
+// Time to rebuild `book` after a restart: replaying its whole journal, against taking a
+// snapshot of it and loading that (the journal after the snapshot being empty)
+template <typename Book>
+void benchRestart(const Book& book, const Journal& journal, Price center, std::size_t orderCapacity) {
+    using Seconds = std::chrono::duration<double>;
+    BookConfig config;
+    config.orderCapacity = orderCapacity;
+
+    auto start = Clock::now();
+    Book replayed(config);
+    replayed.recenter(center);
+    replayJournal(journal, replayed);
+    const double replaySeconds = Seconds(Clock::now() - start).count();
+
+    const std::string path = journal.path() + ".snapshot";
+    BookImage image;
+    start = Clock::now();
+    book.capture(image);
+    image.journalSequence = journal.lastSequence();
+    const double captureSeconds = Seconds(Clock::now() - start).count();
+    start = Clock::now();
+    writeSnapshot(path, image);
+    const double writeSeconds = Seconds(Clock::now() - start).count();
+    start = Clock::now();
+    Book restored(config);
+    restored.recenter(center);
+    recoverBook(restored, path, journal);
+    const double loadSeconds = Seconds(Clock::now() - start).count();
+    std::filesystem::remove(path);
+
+    std::cout << "  restart: replay " << journal.size() << " journal records " << replaySeconds * 1e3 << " ms | snapshot of "
+              << image.orders.size() << " orders: capture " << captureSeconds * 1e3 << " ms, write (background) "
+              << writeSeconds * 1e3 << " ms, load " << loadSeconds * 1e3 << " ms\n";
+}
+
+// The flow against a book that journals every outcome, under each flush policy. The policies
+// that wait for the disk get the first `syncedOrders` commands only.
+void benchJournal(const std::vector<FlowCommand>& flow, Price center, std::size_t syncedOrders) {
+    const auto path = std::filesystem::temp_directory_path() / "MultiTypeOrderbookBench.journal";
+    const std::pair<JournalFlush, const char*> policies[] = {
+        {JournalFlush::ASYNC, "dense + Journal(async flush)  "},
+        {JournalFlush::BATCHED, "dense + Journal(batched msync)"},
+        {JournalFlush::PER_EVENT, "dense + Journal(per-event)    "}};
+    for (const auto& [policy, label] : policies) {
+        const std::vector<FlowCommand> commands(flow.begin(), policy == JournalFlush::ASYNC ? flow.end()
+                                                : flow.begin() + static_cast<std::ptrdiff_t>(std::min(flow.size(), syncedOrders)));
+        std::filesystem::remove(path);
+        BookConfig config;
+        config.orderCapacity = commands.size();
+        Journal journal(path.string(), JournalConfig{policy, 4 * commands.size()});
+        BasicOrderbook<DenseBackend<>, JournalSink> book(config, JournalSink(&journal));
+        benchBook(label, commands, center, book);
+        if (policy == JournalFlush::ASYNC) benchRestart(book, journal, center, config.orderCapacity);
+    }
+    std::filesystem::remove(path);
+}
+
+// The flow streaming its outcomes to disk through an AsyncWriter, on io_uring and on the writer
+// thread: the trade tape, then the full journal synced once per command and restarted from
+// (the stream is a journal file). The writer threads run on the layout's journal CPUs.
+void benchAsyncWriter(const std::vector<FlowCommand>& flow, Price center, const CoreLayout& layout) {
+    const auto path = std::filesystem::temp_directory_path() / "MultiTypeOrderbookBench.stream";
+    std::vector<ThreadPlacement> placements;
+    for (const bool useIoUring : {true, false}) {
+        for (const bool journal : {false, true}) {
+            std::filesystem::remove(path);
+            BookConfig config;
+            config.orderCapacity = flow.size();
+            AsyncWriter writer(path.string(), WriterConfig{1 << 16, 16, useIoUring, layout.journal});
+            if (journal) placements.push_back(writer.placement());
+            const std::string backend = writer.backend() == WriterBackend::THREAD ? "thread  "
+                                        : writer.registeredBuffers()              ? "io_uring"
+                                                                                  : "io_uring (unregistered)";
+            BasicOrderbook<DenseBackend<>, AsyncWriterSink> book(
+                    config, AsyncWriterSink(&writer, journal ? WriterStream::JOURNAL : WriterStream::TRADE_TAPE, journal));
+            benchBook("dense + AsyncWriter(" + backend + (journal ? ", journal synced)" : ", tape)          "), flow, center, book);
+            book.getSink().finish();
+            writer.flushAll(true);
+            if (journal) {
+                std::cout << "  " << (writer.durableBytes() - sizeof(JournalHeader)) / sizeof(JournalRecord) << " records on disk, "
+                          << writer.stalls() << " stalls waiting for a buffer\n";
+                benchRestart(book, Journal(path.string()), center, config.orderCapacity);
+            } else {
+                std::cout << "  " << writer.durableBytes() / sizeof(EventRecord) << " records on disk, " << writer.stalls()
+                          << " stalls waiting for a buffer\n";
+            }
+        }
+    }
+    std::filesystem::remove(path);
+    std::cout << "async writer thread layout (io_uring, thread):\n";
+    printLayout(std::cout, placements);
+}
+
+// The flow as a capture file: exponential gaps averaging `meanGapNs`, and a quarter of the
+// cancels turned into modifies that move the order one tick away from the touch
+std::vector<CaptureRecord> makeCapture(const std::vector<FlowCommand>& flow, std::uint64_t seed, double meanGapNs) {
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap(1.0 / meanGapNs);
+    std::vector<std::size_t> submitIndex;       // flow index of the n-th SUBMIT
+    std::vector<CaptureRecord> records;
+    records.reserve(flow.size());
+    double timestamp = 0;
+    for (std::size_t i = 0; i < flow.size(); ++i) {
+        const FlowCommand& cmd = flow[i];
+        timestamp += gap(rng);
+        const auto ts = static_cast<std::uint64_t>(timestamp);
+        if (cmd.kind == FlowCommand::Kind::SUBMIT) {
+            submitIndex.push_back(i);
+            records.push_back(CaptureRecord::add(ts, cmd.request));
+            continue;
+        }
+        const std::size_t ref = submitIndex[cmd.cancelRef];
+        const OrderRequest& target = flow[ref].request;
+        if (cmd.cancelRef % 4 == 0) {
+            const Price away = target.side == Side::BUY ? -1 : 1;
+            records.push_back(CaptureRecord::modify(ts, ref, target.price + away, target.quantity));
+        } else {
+            records.push_back(CaptureRecord::cancel(ts, ref));
+        }
+    }
+    return records;
+}
+
+// Replay a capture file through a fresh book under `config`
+void benchReplay(std::string_view label, const std::string& path, Price center, ReplayConfig config) {
+    const FlowCapture capture(path);
+    BookConfig bookConfig;
+    bookConfig.orderCapacity = std::max<std::size_t>(capture.size(), 1);
+    BasicOrderbook<DenseBackend<>, NullSink> book(bookConfig);
+    book.recenter(center);
+    LatencyRecorder latency(capture.size());
+    const ReplayStats stats = replayCapture(book, capture, config, latency);
+    latency.print(label, stats.wall);
+    std::cout << "  " << stats.unmatched << " cancels / modifies of orders already gone";
+    if (config.pacing != ReplayPacing::AS_FAST_AS_POSSIBLE) {
+        std::cout << ", fell behind schedule by up to " << std::chrono::duration<double, std::micro>(stats.maxLag).count() << " us";
+    }
+    std::cout << "\n";
+}
+
+// The flow recorded at ~1M msgs/s, replayed as fast as possible, at 10x and in real time
+void benchReplays(const std::vector<FlowCommand>& flow, Price center, std::uint64_t seed) {
+    const auto path = (std::filesystem::temp_directory_path() / "MultiTypeOrderbookBench.capture").string();
+    writeCapture(path, makeCapture(flow, seed, 1000.0));
+    benchReplay("replay, as fast as possible", path, center, ReplayConfig{});
+    benchReplay("replay, 10x real time      ", path, center, ReplayConfig{ReplayPacing::SCALED, 10.0});
+    benchReplay("replay, real time          ", path, center, ReplayConfig{ReplayPacing::REAL_TIME});
+    std::filesystem::remove(path);
+}
+
+// `count` resting orders within 2000 ticks of `center`, grouped by level (bids best first,
+// then asks best first) the way a book dump lists them
+std::vector<OpeningOrder> makeOpeningBook(std::size_t count, Price center, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<Price> offset(1, 2000);
+    std::uniform_int_distribution<Quantity> qty(1, 500);
+    std::vector<OpeningOrder> orders;
+    orders.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Side side = (rng() & 1) ? Side::BUY : Side::SELL;
+        orders.push_back(OpeningOrder{side, side == Side::BUY ? center - offset(rng) : center + offset(rng), qty(rng)});
+    }
+    std::stable_sort(orders.begin(), orders.end(), [](const OpeningOrder& a, const OpeningOrder& b) {
+        if (a.side != b.side) return a.side == Side::BUY;
+        return a.side == Side::BUY ? a.price > b.price : a.price < b.price;
+    });
+    return orders;
+}
+
+// The same book as CSV, prices in dollars at the default tick of 0.01
+void writeOpeningBookCsv(const std::string& path, std::span<const OpeningOrder> orders) {
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) throw std::system_error(errno, std::generic_category(), "Cannot create " + path);
+    bool written = std::fputs("side,price,quantity\n", out) >= 0;
+    char line[64];
+    for (const OpeningOrder& order : orders) {
+        char* p = line;
+        *p++ = order.side == Side::BUY ? 'B' : 'S';
+        *p++ = ',';
+        p = std::to_chars(p, line + sizeof(line), static_cast<double>(order.price) / 100.0, std::chars_format::fixed, 2).ptr;
+        *p++ = ',';
+        p = std::to_chars(p, line + sizeof(line), order.quantity).ptr;
+        *p++ = '\n';
+        const auto size = static_cast<std::size_t>(p - line);
+        written = written && std::fwrite(line, 1, size, out) == size;
+    }
+    const int error = errno;
+    if (std::fclose(out) != 0 || !written) throw std::system_error(error, std::generic_category(), "Cannot write opening book " + path);
+}
+
+// Starting a day on `count` loaded orders: reading the file (CSV parsed with from_chars, or
+// binary used in place), then building the book in one pass, against submitting the same
+// orders one by one
+void benchOpeningBook(std::size_t count, Price center, std::uint64_t seed) {
+    using Millis = std::chrono::duration<double, std::milli>;
+    const auto directory = std::filesystem::temp_directory_path();
+    const std::string csvPath = (directory / "MultiTypeOrderbookBench.book.csv").string();
+    const std::string binaryPath = (directory / "MultiTypeOrderbookBench.book").string();
+    {
+        const auto orders = makeOpeningBook(count, center, seed);
+        writeOpeningBookCsv(csvPath, orders);
+        writeOpeningBook(binaryPath, orders, center);
+    }
+    BookConfig config;
+    config.orderCapacity = count;
+
+    auto start = Clock::now();
+    const OpeningBookFile csv(csvPath);
+    const Millis csvTime = Clock::now() - start;
+    start = Clock::now();
+    const OpeningBookFile binary(binaryPath);
+    const Millis binaryTime = Clock::now() - start;
+
+    auto build = [&]<typename Book>(std::type_identity<Book>, auto&& load) {
+        Book book(config);
+        const auto t0 = Clock::now();
+        load(book);
+        return Millis(Clock::now() - t0);
+    };
+    const Millis bulkMap = build(std::type_identity<BasicOrderbook<MapBackend, NullSink>>{},
+                                 [&](auto& book) { book.loadOpeningBook(binary.orders(), binary.todaysPrice()); });
+    const Millis bulkDense = build(std::type_identity<BasicOrderbook<DenseBackend<>, NullSink>>{},
+                                   [&](auto& book) { book.loadOpeningBook(binary.orders(), binary.todaysPrice()); });
+    const Millis oneByOne = build(std::type_identity<BasicOrderbook<MapBackend, NullSink>>{}, [&](auto& book) {
+        ExecutionReport report;
+        for (const OpeningOrder& order : binary.orders()) {
+            book.submit({order.side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, order.price, order.quantity}, report);
+        }
+    });
+
+    std::cout << "opening book of " << count << " orders: CSV (" << std::filesystem::file_size(csvPath) / 1000000.0
+              << " MB) mapped + parsed " << csvTime.count() << " ms (" << csv.orders().size() << " orders), binary mapped "
+              << binaryTime.count() << " ms\n"
+              << "  bulk build: map " << bulkMap.count() << " ms, dense " << bulkDense.count()
+              << " ms | submit one by one (map) " << oneByOne.count() << " ms\n";
+    std::filesystem::remove(csvPath);
+    std::filesystem::remove(binaryPath);
+}
+
+// Same flow, but runs of consecutive submits go through submitBatch in bursts of up to `burst`.
+// Latency is recorded per burst and divided over its orders.
+template <typename Book>
+void benchBatch(std::string_view label, const std::vector<FlowCommand>& flow, Price center, Book& book, std::size_t burst) {
+    book.recenter(center);
+
+    std::vector<OrderID> ids;
+    ids.reserve(flow.size());
+    std::vector<OrderRequest> requests;
+    requests.reserve(burst);
+    std::vector<ExecutionReport> reports(burst);
+    for (auto& report : reports) report.fills.reserve(256);
+    LatencyRecorder latency(flow.size());
+
+    auto submitPending = [&] {
+        if (requests.empty()) return;
+        const auto t0 = Clock::now();
+        book.submitBatch(requests, reports);
+        const auto perOrder = (Clock::now() - t0) / requests.size();
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            ids.push_back(reports[i].orderId);
+            latency.record(perOrder);
+        }
+        requests.clear();
+    };
+
+    const auto start = Clock::now();
+    for (const auto& cmd : flow) {
+        if (cmd.kind == FlowCommand::Kind::SUBMIT) {
+            requests.push_back(cmd.request);
+            if (requests.size() == burst) submitPending();
+        } else {
+            submitPending();
+            const auto t0 = Clock::now();
+            book.cancel(ids[cmd.cancelRef]);
+            latency.record(Clock::now() - t0);
+        }
+    }
+    submitPending();
+    latency.print(label, Clock::now() - start);
+}
+
+// Handing EngineCommands from one thread to another over an SpscRing: one at a time, waiting
+// for each to arrive (handoff latency, push to pop), then in batches of 64 (throughput).
+// Spin until `ready()`, yielding after a while so this still makes progress on a single CPU
+template <typename F>
+void spinUntil(F&& ready) {
+    for (int spins = 0; !ready(); ++spins) {
+        if (spins >= 256) std::this_thread::yield();
+    }
+}
+
+void benchSpscHandoff(std::size_t count) {
+    struct Stamped {
+        EngineCommand     command;
+        Clock::time_point sent;
+    };
+    auto ring = std::make_unique<SpscRing<Stamped, 4096>>();
+    LatencyRecorder latency(count);
+    std::atomic<std::size_t> received{0};
+
+    std::jthread consumer([&] {
+        Stamped item;
+        for (std::size_t i = 0; i < count; ++i) {
+            spinUntil([&] { return ring->tryPop(item); });
+            latency.record(Clock::now() - item.sent);
+            received.store(i + 1, std::memory_order_release);
+        }
+    });
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        spinUntil([&] { return ring->tryPush(Stamped{EngineCommand{}, Clock::now()}); });
+        spinUntil([&] { return received.load(std::memory_order_acquire) > i; });
+    }
+    consumer.join();
+    latency.print("spsc handoff, one at a time", Clock::now() - start);
+
+    std::jthread batchConsumer([&] {
+        std::array<Stamped, 64> items;
+        for (std::size_t got = 0; got < count;) {
+            const std::size_t n = ring->popBatch(items);
+            if (n == 0) std::this_thread::yield();
+            got += n;
+        }
+    });
+    const auto batchStart = Clock::now();
+    std::array<Stamped, 64> items{};
+    for (std::size_t sent = 0; sent < count;) {
+        const std::size_t n = std::min(items.size(), count - sent);
+        const std::size_t pushed = ring->pushBatch(std::span<const Stamped>(items.data(), n));
+        if (pushed == 0) std::this_thread::yield();
+        sent += pushed;
+    }
+    batchConsumer.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+    std::cout << "spsc handoff, batches of 64: " << count << " ops | "
+              << static_cast<double>(count) / seconds / 1e6 << " M ops/s\n";
+}
+
+// 1 to 32 threads pushing EngineCommands into one MpscRing drained by one consumer.
+// Latency is per push, including retries while the ring is full.
+void benchMpscContention(std::size_t count) {
+    for (std::size_t producers = 1; producers <= 32; producers *= 2) {
+        auto ring = std::make_unique<MpscRing<EngineCommand, 4096>>();
+        const std::size_t perProducer = count / producers;
+        const std::size_t total = perProducer * producers;
+        std::vector<LatencyRecorder> latencies;
+        for (std::size_t p = 0; p < producers; ++p) latencies.emplace_back(perProducer);
+
+        const auto start = Clock::now();
+        std::jthread consumer([&] {
+            std::array<EngineCommand, 64> items;
+            for (std::size_t got = 0; got < total;) {
+                const std::size_t n = ring->popBatch(items);
+                if (n == 0) std::this_thread::yield();
+                got += n;
+            }
+        });
+        {
+            std::vector<std::jthread> threads;
+            for (std::size_t p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p] {
+                    const EngineCommand command{EngineCommand::Kind::SUBMIT, static_cast<SymbolId>(p)};
+                    for (std::size_t i = 0; i < perProducer; ++i) {
+                        const auto t0 = Clock::now();
+                        spinUntil([&] { return ring->tryPush(command).has_value(); });
+                        latencies[p].record(Clock::now() - t0);
+                    }
+                });
+            }
+        }
+        consumer.join();
+        const auto wall = Clock::now() - start;
+
+        LatencyRecorder all(total);
+        for (const auto& latency : latencies) all.merge(latency);
+        all.print("mpsc, " + std::to_string(producers) + " producer(s)", wall);
+    }
+}
+
+// Cost of publishing a 10-level depth snapshot through a Seqlock from a book built by the
+// flow, with one reader thread (on the layout's market data CPUs) copying snapshots concurrently
+// the whole time.
+void benchDepthPublish(const std::vector<FlowCommand>& flow, Price center, const CoreLayout& layout) {
+    BookConfig config;
+    config.orderCapacity = flow.size();
+    BasicOrderbook<DenseBackend<>, NullSink> book(config);
+    book.recenter(center);
+    std::vector<OrderID> ids;
+    ExecutionReport report;
+    for (const auto& cmd : flow) {
+        if (cmd.kind == FlowCommand::Kind::SUBMIT) {
+            book.submit(cmd.request, report);
+            ids.push_back(report.orderId);
+        } else {
+            book.cancel(ids[cmd.cancelRef]);
+        }
+    }
+
+    using Snapshot = DepthSnapshot<10>;
+    auto published = std::make_unique<Seqlock<Snapshot>>();
+    const std::size_t count = 1'000'000;
+    LatencyRecorder latency(count);
+    std::atomic<bool> done{false};
+    std::size_t reads = 0, retries = 0;
+    ThreadPlacement readerPlacement;
+    std::jthread reader([&] {
+        readerPlacement = layout.apply(ThreadRole::MARKET_DATA, 0);
+        Snapshot copy;
+        while (!done.load(std::memory_order_relaxed)) {
+            if (published->tryLoad(copy)) ++reads;
+            else                          ++retries;
+        }
+    });
+
+    Snapshot snapshot;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto t0 = Clock::now();
+        book.snapshotDepth(snapshot);
+        snapshot.sequence = i;
+        published->store(snapshot);
+        latency.record(Clock::now() - t0);
+    }
+    const auto wall = Clock::now() - start;
+    done = true;
+    reader.join();
+    latency.print("depth publish (10 levels, " + std::to_string(sizeof(Snapshot)) + " bytes)", wall);
+    std::cout << "  concurrent reader: " << reads << " consistent copies, " << retries << " retries\n";
+    printLayout(std::cout, std::span(&readerPlacement, 1));
+}
+
+// Many simulated client sessions as coroutines on one thread, each submitting its own
+// deterministic flow (passive and marketable limits, canceling what rests now and then).
+template <typename Loop>
+Session benchClient(Loop& loop, Price center, std::uint64_t seed, std::size_t orders) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<Price> offset(-5, 50);
+    std::uniform_int_distribution<Quantity> qty(1, 500);
+    for (std::size_t i = 0; i < orders; ++i) {
+        const Side side = (rng() & 1) ? Side::BUY : Side::SELL;
+        const Price price = center + ((side == Side::BUY) ? -offset(rng) : offset(rng));
+        const ExecutionReport report = co_await loop.submit({side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, price, qty(rng)});
+        if (report.restingQuantity > 0 && rng() % 3 == 0) co_await loop.cancel(report.orderId);
+    }
+}
+
+void benchSessions(Price center, std::size_t sessions, std::size_t ordersPerSession, std::uint64_t seed) {
+    BookConfig config;
+    config.orderCapacity = sessions * ordersPerSession;
+    BasicOrderbook<DenseBackend<>, NullSink> book(config);
+    book.recenter(center);
+    SessionLoop loop(book);
+    for (std::size_t i = 0; i < sessions; ++i) loop.spawn(benchClient(loop, center, pathSeed(seed, static_cast<std::uint32_t>(i)), ordersPerSession));
+
+    const auto start = Clock::now();
+    loop.run();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "coroutine sessions, " << sessions << " on one thread: " << loop.operationsCompleted() << " ops | "
+              << static_cast<double>(loop.operationsCompleted()) / seconds / 1e6 << " M ops/s\n";
+}
+
+// seeds x symbols x days of simulation on a work-stealing pool, once on one thread and once on
+// every CPU; the per-path results must match exactly.
+void benchSimulation(std::uint64_t seed) {
+    SimulationConfig config;
+    config.firstSeed = seed;
+    config.seeds = 4;
+    config.symbols = 8;
+    config.days = 10;
+    config.ordersPerDay = 5'000;
+
+    std::vector<SimulationSummary> runs;
+    for (std::size_t threads : {std::size_t{1}, std::size_t{cpuCount()}}) {
+        WorkStealingPool pool(threads);
+        runs.push_back(runSimulation(config, pool));
+        const SimulationSummary& run = runs.back();
+        std::cout << "simulation, " << threads << " thread(s): " << run.paths.size() << " paths, " << run.days << " days | "
+                  << run.daysPerSecond() << " days/s | " << pool.steals() << " steals | volume " << run.totalVolume()
+                  << " | mean close " << run.meanClosePrice() << "\n";
+    }
+    const bool same = std::equal(runs[0].paths.begin(), runs[0].paths.end(), runs[1].paths.begin(),
+                                 [](const PathResult& a, const PathResult& b) {
+                                     return a.closePrice == b.closePrice && a.volume == b.volume && a.trades == b.trades;
+                                 });
+    std::cout << "  per-path results " << (same ? "identical" : "DIFFER") << " across thread counts\n";
+}
+
+// The same flow spread round-robin over `symbols` books in the sharded engine, for 1, 2, 4, ...
+// shards up to the CPU count. Cancels are left out: the ids they need are assigned on the shards.
+// With a core layout, this thread posts as the gateway and shards run on the matching CPUs.
+void benchEngine(const std::vector<FlowCommand>& flow, Price center, std::size_t symbols, const CoreLayout& layout) {
+    BookConfig config;
+    config.orderCapacity = flow.size() / symbols;
+    config.onPoolExhausted = PoolExhaustion::GROW;
+    std::vector<SymbolSpec> specs;
+    for (std::size_t i = 0; i < symbols; ++i) specs.push_back({"SYM" + std::to_string(i), center, config});
+
+    std::vector<EngineCommand> commands;
+    commands.reserve(flow.size());
+    for (const auto& cmd : flow) {
+        if (cmd.kind != FlowCommand::Kind::SUBMIT) continue;
+        commands.push_back({EngineCommand::Kind::SUBMIT, static_cast<SymbolId>(commands.size() % symbols), cmd.request});
+    }
+
+    std::vector<std::size_t> shardCounts;
+    for (std::size_t n = 1; n < cpuCount(); n *= 2) shardCounts.push_back(n);
+    shardCounts.push_back(cpuCount());
+
+    std::vector<ThreadPlacement> placements{layout.apply(ThreadRole::GATEWAY, 0)};
+    for (std::size_t shards : shardCounts) {
+        EngineConfig engineConfig{shards};
+        engineConfig.layout = layout;
+        Engine engine(specs, engineConfig);
+        if (shards == shardCounts.back()) {
+            const auto shardPlacements = engine.placements();
+            placements.insert(placements.end(), shardPlacements.begin(), shardPlacements.end());
+        }
+        const auto start = Clock::now();
+        for (const auto& command : commands) engine.post(command);
+        engine.drain();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "engine, " << symbols << " symbols, " << shards << " shard(s): " << commands.size() << " ops | "
+                  << static_cast<double>(commands.size()) / seconds / 1e6 << " M ops/s\n";
+    }
+    std::cout << "engine thread layout:\n";
+    printLayout(std::cout, placements);
+}
+
+// One shard fed by this thread under each wait strategy: throughput, and the CPU time the
+// process burned per wall-clock second (spinning consumers keep it at a core or more).
+void benchWaitStrategies(const std::vector<FlowCommand>& flow, Price center) {
+    std::vector<SymbolSpec> specs;
+    for (std::size_t i = 0; i < 100; ++i) specs.push_back({"SYM" + std::to_string(i), center});
+    std::vector<EngineCommand> commands;
+    for (const auto& cmd : flow) {
+        if (cmd.kind != FlowCommand::Kind::SUBMIT) continue;
+        commands.push_back({EngineCommand::Kind::SUBMIT, static_cast<SymbolId>(commands.size() % specs.size()), cmd.request});
+        if (commands.size() == 100'000) break;
+    }
+
+    const std::pair<WaitStrategy, const char*> strategies[] = {
+        {WaitStrategy::BUSY_SPIN, "busy spin "}, {WaitStrategy::SPIN_YIELD, "spin-yield"},
+        {WaitStrategy::SPIN_PARK, "spin-park "}, {WaitStrategy::BLOCKING, "blocking  "}};
+    for (const auto& [strategy, name] : strategies) {
+        EngineConfig config{1};
+        config.waitStrategy = strategy;
+        Engine engine(specs, config);
+        const std::clock_t cpuStart = std::clock();
+        const auto start = Clock::now();
+        // Bursts with gaps in between, so the shard goes idle and has to wake up again
+        for (std::size_t i = 0; i < commands.size(); ++i) {
+            engine.post(commands[i]);
+            if (i % 1000 == 999) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        engine.drain();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        std::cout << "wait " << name << ": " << commands.size() << " ops in " << seconds * 1e3 << " ms | CPU "
+                  << 100.0 * cpuSeconds / seconds << "% of one core\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t seed = 42;
+    std::string replayPath;
+    double speed = 0;
+    std::vector<std::string_view> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg == "--seed" && i + 1 < argc)        seed = std::stoull(argv[++i]);
+        else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+        else if (arg == "--speed" && i + 1 < argc)  speed = std::stod(argv[++i]);
+        else args.push_back(arg);
+    }
+    if (!replayPath.empty()) {
+        // A recorded capture instead of the benchmarks; the book is centered on its first limit order
+        Price center = 10'000;
+        const FlowCapture capture(replayPath);
+        for (const CaptureRecord& record : capture.records()) {
+            if (record.kind == CaptureRecord::Kind::ADD) {
+                center = record.price;
+                break;
+            }
+        }
+        const ReplayConfig config = speed <= 0    ? ReplayConfig{}
+                                    : speed == 1  ? ReplayConfig{ReplayPacing::REAL_TIME}
+                                                  : ReplayConfig{ReplayPacing::SCALED, speed};
+        benchReplay("replay " + replayPath, replayPath, center, config);
+        return 0;
+    }
+    const std::size_t orders = args.size() > 0 ? std::stoul(std::string(args[0])) : 1'000'000;
+    const CoreLayout layout = args.size() > 1 ? CoreLayout::parse(args[1]) : CoreLayout{};
+    const Price center = 10'000;
+    std::cout << "seed " << seed << "\n";
+    const auto flow = makeFlow(orders, center, seed);
+
+    benchBook<BasicOrderbook<MapBackend, NullSink>>("map   + NullSink  ", flow, center);
+    benchBook<BasicOrderbook<DenseBackend<>, NullSink>>("dense + NullSink  ", flow, center);
+
+    BookConfig config;
+    config.orderCapacity = flow.size();
+    std::FILE* devNull = std::fopen("/dev/null", "wb");
+    BasicOrderbook<DenseBackend<>, BinarySink> binary(config, BinarySink(devNull));
+    benchBook("dense + BinarySink", flow, center, binary);
+
+    BasicOrderbook<DenseBackend<>, BinarySink> batched(config, BinarySink(devNull));
+    benchBatch("dense + BinarySink, submitBatch(64)", flow, center, batched, 64);
+    std::fclose(devNull);
+    benchJournal(flow, center, 20'000);
+    benchAsyncWriter(flow, center, layout);
+    benchReplays(flow, center, seed);
+    benchOpeningBook(orders, center, seed);
+
+    benchDepthPublish(flow, center, layout);
+    benchSessions(center, 10'000, 50, seed);
+    benchSimulation(seed);
+    benchSpscHandoff(orders / 10);
+    benchMpscContention(orders);
+    benchEngine(flow, center, 1000, layout);   // pins this thread as the gateway from here on
+    benchWaitStrategies(flow, center);
+
+    return 0;
+}
@@ -0,0 +1,664 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#include "corelayout.hpp"
+#include "eventsink.hpp"
+#include "journal.hpp"
+#include "spscring.hpp"
+#include "waitstrategy.hpp"
+
+// How an AsyncWriter gets its buffers to the file
+enum class WriterBackend {
+    IO_URING,       // the submitting thread queues writes on an io_uring; the kernel does the rest
+    THREAD          // a dedicated writer thread pwrite()s them (where io_uring is unavailable)
+};
+
+struct WriterConfig {
+    std::size_t bufferSize = 1 << 16;
+    std::size_t bufferCount = 16;       // buffers in flight at most; up to AsyncWriter::MaxBuffers
+    bool        useIoUring = true;      // false: always the writer thread
+    CpuSet      cpus{};                 // where the writer / completion thread runs, e.g. CoreLayout::journal; empty: anywhere
+};
+
+// Appends to a file without the submitting thread ever waiting for the disk.
+// The producer fills fixed-size buffers owned by the writer and hands them over one at a time;
+// each is written at the next offset of the file, and a hand-over can ask for everything
+// written so far to be made durable once this buffer is. With io_uring the buffers are
+// registered with the kernel once (no per-write page pinning), a write and its fdatasync go
+// out as one linked pair, and handing a buffer over is one non-blocking io_uring_enter; a
+// completion thread reaps the ring. Where io_uring can't be set up (old kernel, seccomp) the
+// same calls feed a writer thread.
+// Syncs are group-committed: one asked for while another is running isn't queued behind it.
+// The writer side (writer or completion thread) issues a single fdatasync for all of them as
+// soon as their bytes are written, so a sync is never left waiting for the producer's next call.
+// A producer syncing small units of work (syncThrough) keeps filling the same buffer: the
+// writer side writes the part it published itself before syncing.
+// Single producer: acquire / submit / tryAcquire must all come from one thread.
+class AsyncWriter {
+public:
+    static constexpr std::size_t MaxBuffers = 1024;
+
+    explicit AsyncWriter(const std::string& path, WriterConfig config = WriterConfig{})
+            : _bufferSize(config.bufferSize), _bufferCount(config.bufferCount) {
+        if (_bufferSize == 0 || _bufferSize > UINT32_MAX || _bufferCount == 0 || _bufferCount > MaxBuffers) {
+            throw std::invalid_argument("AsyncWriter needs 1 to MaxBuffers buffers of 1 byte to 4 GiB");
+        }
+        _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (_fd < 0) throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+        struct stat st{};
+        if (::fstat(_fd, &st) != 0) {
+            const int error = errno;
+            ::close(_fd);
+            throw std::system_error(error, std::generic_category(), "Cannot stat " + path);
+        }
+        _offset = _written = static_cast<std::uint64_t>(st.st_size);        // appends after what is there
+        _syncWanted = _syncIssued = _syncedTo = _durable = _offset;
+
+        _memory = std::make_unique_for_overwrite<std::byte[]>(_bufferSize * _bufferCount);
+        _base.resize(_bufferCount);
+        _free.reserve(_bufferCount);
+        for (std::size_t i = _bufferCount; i-- > 0;) _free.push_back(static_cast<std::uint32_t>(i));
+
+        const bool ring = config.useIoUring && setupRing();
+        std::latch started(1);
+        _writer = std::jthread([this, ring, cpus = std::move(config.cpus), start = _offset, &started](std::stop_token stop) {
+            _placement = CoreLayout::placeThisThread(ThreadRole::JOURNAL, 0, cpus);
+            started.count_down();
+            if (ring) reaperLoop(stop, start);
+            else      writerLoop(stop, start);
+        });
+        started.wait();
+    }
+
+    // Everything handed over is written and made durable before the file is closed. A buffer
+    // still acquired was never handed over and is dropped; a failed write or sync is left in
+    // error() rather than thrown.
+    ~AsyncWriter() {
+        if (_current != NoBuffer) _free.push_back(std::exchange(_current, NoBuffer));
+        try {
+            flushAll(true);
+        } catch (const std::system_error&) {
+        }
+        _writer.request_stop();
+        if (_ring) wakeReaper();
+        else       _wake.ring();
+        _writer.join();
+        if (_ring) teardownRing();
+        ::close(_fd);
+    }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    [[nodiscard]] WriterBackend backend() const { return _ring ? WriterBackend::IO_URING : WriterBackend::THREAD; }
+
+    // io_uring with the buffers registered with the kernel (else plain io_uring writes)
+    [[nodiscard]] bool registeredBuffers() const {
+#if defined(__linux__)
+        return _ring && _ring->fixedBuffers;
+#else
+        return false;
+#endif
+    }
+
+    [[nodiscard]] std::size_t bufferSize() const { return _bufferSize; }
+
+    // Where the writer / completion thread runs (a JOURNAL thread)
+    [[nodiscard]] const ThreadPlacement& placement() const { return _placement; }
+
+    // An empty buffer to fill, or an empty span if every buffer is still in flight
+    std::span<std::byte> tryAcquire() {
+        if (_current == NoBuffer) {
+            reap();
+            if (_free.empty()) return {};
+            _current = _free.back();
+            _free.pop_back();
+            _base[_current] = _offset;
+        }
+        return {_memory.get() + std::size_t{_current} * _bufferSize, _bufferSize};
+    }
+
+    // Same, but if every buffer is in flight waits for one (the disk isn't keeping up)
+    std::span<std::byte> acquire() {
+        std::span<std::byte> buffer = tryAcquire();
+        if (buffer.empty()) ++_stalls;
+        while (buffer.empty()) {
+            waitForCompletion();
+            buffer = tryAcquire();
+        }
+        return buffer;
+    }
+
+    // Hand over the first `size` bytes of the acquired buffer. With `sync`, everything submitted
+    // so far is made durable (fdatasync'ed) once written, by a sync of its own or by one shared
+    // with the hand-overs around it.
+    void submit(std::size_t size, bool sync = false) {
+        if (_current == NoBuffer) throw std::logic_error("AsyncWriter::submit without an acquired buffer");
+        const std::uint32_t buffer = std::exchange(_current, NoBuffer);
+        _published.store(NoPublished, std::memory_order_relaxed);     // ordered by the job's hand-over
+        if (size == 0) _free.push_back(buffer);
+        if (size != 0 || sync) queue(buffer, static_cast<std::uint32_t>(size), sync);
+    }
+
+    // Make everything submitted, and the first `used` bytes of the acquired buffer, durable
+    // without handing the buffer over: the producer goes on filling it after those bytes, which
+    // must not change (and go out with the buffer when it is submitted). Costs the producer two
+    // atomic stores; the writer side writes the bytes
+    // and syncs them together with whatever else is asked for meanwhile.
+    void syncThrough(std::size_t used) {
+        if (_current == NoBuffer) throw std::logic_error("AsyncWriter::syncThrough without an acquired buffer");
+        _published.store(std::uint64_t{_current} << 32 | used, std::memory_order_release);
+        wantSync(_offset + used);
+    }
+
+    // Block until everything handed over is written (and, with `sync`, durable).
+    // Not while holding an acquired buffer: submit it first.
+    void flushAll(bool sync = false) {
+        if (_current != NoBuffer) throw std::logic_error("AsyncWriter::flushAll with a buffer acquired");
+        if (sync && _syncWanted.load(std::memory_order_relaxed) < _offset) queue(NoBuffer, 0, true);
+        while (_pending > 0 || (sync && _syncedTo.load(std::memory_order_acquire) < _offset)) waitForCompletion();
+        if (const int error = this->error()) throw std::system_error(error, std::generic_category(), "AsyncWriter write failed");
+    }
+
+    // As far as the producer has seen completions: bytes on their way to / in the file
+    [[nodiscard]] std::uint64_t submittedBytes() const { return _offset; }
+    [[nodiscard]] std::uint64_t writtenBytes() const { return _written; }
+    [[nodiscard]] std::uint64_t durableBytes() const { return _durable.load(std::memory_order_acquire); }
+
+    // Times acquire() had to wait for a buffer
+    [[nodiscard]] std::uint64_t stalls() const { return _stalls; }
+
+    // First error a write or sync hit (0 if none); later hand-overs are still attempted
+    [[nodiscard]] int error() const { return _error.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::uint32_t NoBuffer = ~std::uint32_t{0};
+    static constexpr std::uint64_t SyncTag = std::uint64_t{1} << 63;
+    static constexpr std::uint64_t WakeTag = std::uint64_t{1} << 62;
+    static constexpr std::uint64_t NoPublished = ~std::uint64_t{0};
+
+    struct Job {
+        std::uint32_t buffer;
+        std::uint32_t size;
+        std::uint64_t offset;
+        std::uint64_t sequence;     // io_uring: hand-over number, the write's user_data
+    };
+
+    // A written buffer, back to the producer
+    struct Done {
+        std::uint32_t buffer;
+        std::uint64_t end;          // offset just past the job's bytes
+    };
+
+    void queue(std::uint32_t buffer, std::uint32_t size, bool sync) {
+        if (_ring) queueOnRing(buffer, size, sync);
+        else       queueOnThread(buffer, size, sync);
+        _offset += size;
+    }
+
+    void fail(int error) {
+        int none = 0;
+        _error.compare_exchange_strong(none, error, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    // Ask the writer side to sync everything up to `end`
+    void wantSync(std::uint64_t end) {
+        _syncWanted.store(end);
+        if (!_ring)                         _wake.notify();
+        else if (_reaperWaiting.load())     wakeReaper();       // see reaperLoop
+    }
+
+    // Writer side: write a whole job's bytes, true if they all made it
+    bool writeOut(std::uint32_t buffer, std::size_t size, std::uint64_t offset) {
+        const std::byte* data = _memory.get() + std::size_t{buffer} * _bufferSize;
+        for (std::size_t done = 0; done < size;) {
+            const ssize_t n = ::pwrite(_fd, data + done, size - done, static_cast<off_t>(offset + done));
+            if (n > 0) {
+                done += static_cast<std::size_t>(n);
+            } else if (n < 0 && errno != EINTR) {
+                fail(errno);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writer side: sync everything up to `wanted` once it is in the file. `written` is the end of
+    // the handed-over bytes written so far; bytes published in the acquired buffer that follow on
+    // from them are written here. Until then, the next job or completion brings it closer.
+    // The acquired buffer can't be reused under us: only this thread hands it back.
+    void syncUpTo(std::uint64_t wanted, std::uint64_t written) {
+        if (wanted <= _syncedTo.load(std::memory_order_relaxed)) return;
+        if (written < wanted) {
+            const std::uint64_t published = _published.load(std::memory_order_acquire);
+            if (published == NoPublished) return;
+            const auto buffer = static_cast<std::uint32_t>(published >> 32);
+            const auto used = static_cast<std::uint32_t>(published);
+            if (_base[buffer] > written) return;
+            writeOut(buffer, used, _base[buffer]);
+            written = std::max(written, _base[buffer] + used);
+            if (written < wanted) return;
+        }
+        synced(wanted, ::fdatasync(_fd) == 0 ? 0 : errno);
+    }
+
+    // Writer side: a sync of everything up to `end` finished
+    void synced(std::uint64_t end, int error) {
+        if (error) fail(error);
+        else if (end > _durable.load(std::memory_order_relaxed)) _durable.store(end, std::memory_order_release);
+        if (end > _syncedTo.load(std::memory_order_relaxed)) _syncedTo.store(end);
+    }
+
+    // Collect the buffers written so far, without blocking
+    void reap() {
+        Done done;
+        while (_done.tryPop(done)) {
+            _free.push_back(done.buffer);
+            _written = std::max(_written, done.end);
+            --_pending;
+        }
+    }
+
+    void waitForCompletion() {
+        const std::size_t before = _free.size();
+        reap();
+        if (_free.size() == before) std::this_thread::yield();
+    }
+
+    // ---- io_uring, through the raw system calls ----
+
+#if defined(__linux__)
+    struct Ring {
+        int            fd{-1};
+        void*          sqMap{nullptr};
+        std::size_t    sqMapSize{0};
+        void*          cqMap{nullptr};
+        std::size_t    cqMapSize{0};
+        io_uring_sqe*  sqes{nullptr};
+        std::size_t    sqesSize{0};
+        unsigned*      sqTail{nullptr};
+        unsigned       sqMask{0};
+        unsigned*      sqArray{nullptr};
+        unsigned*      cqHead{nullptr};
+        unsigned*      cqTail{nullptr};
+        unsigned       cqMask{0};
+        io_uring_cqe*  cqes{nullptr};
+        bool           fixedBuffers{false};
+    };
+
+    bool setupRing() {
+        io_uring_params params{};
+        const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, static_cast<unsigned>(2 * _bufferCount), &params));
+        if (fd < 0) return false;
+
+        Ring ring;
+        ring.fd = fd;
+        ring.sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring.cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) ring.sqMapSize = ring.cqMapSize = std::max(ring.sqMapSize, ring.cqMapSize);
+
+        ring.sqMap = ::mmap(nullptr, ring.sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        ring.cqMap = single ? ring.sqMap
+                            : ::mmap(nullptr, ring.cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (ring.sqMap == MAP_FAILED || ring.cqMap == MAP_FAILED || sqes == MAP_FAILED) {
+            if (ring.sqMap != MAP_FAILED) ::munmap(ring.sqMap, ring.sqMapSize);
+            if (!single && ring.cqMap != MAP_FAILED) ::munmap(ring.cqMap, ring.cqMapSize);
+            if (sqes != MAP_FAILED) ::munmap(sqes, ring.sqesSize);
+            ::close(fd);
+            return false;
+        }
+        auto* sq = static_cast<std::byte*>(ring.sqMap);
+        auto* cq = static_cast<std::byte*>(ring.cqMap);
+        ring.sqes = static_cast<io_uring_sqe*>(sqes);
+        ring.sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring.sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring.sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring.cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring.cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring.cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Registered buffers are pinned once here instead of on every write. Without them
+        // (e.g. RLIMIT_MEMLOCK too low) plain writes still work.
+        std::vector<iovec> iovecs(_bufferCount);
+        for (std::size_t i = 0; i < _bufferCount; ++i) iovecs[i] = iovec{_memory.get() + i * _bufferSize, _bufferSize};
+        ring.fixedBuffers = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                                      static_cast<unsigned>(_bufferCount)) == 0;
+        _ring = ring;
+        return true;
+    }
+
+    void teardownRing() {
+        ::munmap(_ring->sqes, _ring->sqesSize);
+        if (_ring->cqMap != _ring->sqMap) ::munmap(_ring->cqMap, _ring->cqMapSize);
+        ::munmap(_ring->sqMap, _ring->sqMapSize);
+        ::close(_ring->fd);
+        _ring.reset();
+    }
+
+    io_uring_sqe& nextSqe(unsigned& tail) {
+        io_uring_sqe& sqe = _ring->sqes[tail & _ring->sqMask];
+        std::memset(&sqe, 0, sizeof(sqe));
+        _ring->sqArray[tail & _ring->sqMask] = tail & _ring->sqMask;
+        ++tail;
+        return sqe;
+    }
+
+    void enter(unsigned tail, unsigned toSubmit) {
+        std::atomic_ref(*_ring->sqTail).store(tail, std::memory_order_release);
+        if (::syscall(__NR_io_uring_enter, _ring->fd, toSubmit, 0, 0, nullptr, 0) < 0) fail(errno);
+    }
+
+    // The write, then (linked, so only once it has succeeded) the fdatasync. A synced write also
+    // drains: it starts only after every earlier write finished, so the sync covers them all.
+    // The pair goes out only if no sync of ours is running; otherwise the write goes alone and
+    // the completion thread syncs it with whatever else comes in meanwhile.
+    // There is always room: at most bufferCount jobs of two entries are in flight.
+    void queueOnRing(std::uint32_t buffer, std::uint32_t size, bool sync) {
+        const std::uint64_t end = _offset + size;
+        bool linkSync = false;
+        if (sync) {
+            // With a sync of ours still running, the completion thread syncs this one once its
+            // write is in (syncUpTo)
+            linkSync = _syncIssued.load(std::memory_order_relaxed) <= _syncedTo.load(std::memory_order_acquire);
+            if (linkSync) _syncIssued.store(end);
+            wantSync(end);
+        }
+        unsigned tail = std::atomic_ref(*_ring->sqTail).load(std::memory_order_relaxed);
+        unsigned toSubmit = 0;
+        if (size != 0) {
+            const Job job{buffer, size, _offset, _sequence++};
+            while (!_jobs.tryPush(job)) std::this_thread::yield();      // can't happen: as many slots as buffers
+            ++_pending;
+            io_uring_sqe& write = nextSqe(tail);
+            write.opcode = _ring->fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            write.fd = _fd;
+            write.off = job.offset;
+            write.addr = reinterpret_cast<std::uint64_t>(_memory.get() + std::size_t{buffer} * _bufferSize);
+            write.len = size;
+            write.buf_index = static_cast<std::uint16_t>(buffer);
+            write.user_data = job.sequence;
+            if (linkSync) write.flags = IOSQE_IO_LINK | IOSQE_IO_DRAIN;
+            ++toSubmit;
+        }
+        if (linkSync) {
+            io_uring_sqe& fsync = nextSqe(tail);
+            fsync.opcode = IORING_OP_FSYNC;
+            fsync.fd = _fd;
+            fsync.fsync_flags = IORING_FSYNC_DATASYNC;
+            if (size == 0) fsync.flags = IOSQE_IO_DRAIN;
+            fsync.user_data = SyncTag | end;
+            ++toSubmit;
+        }
+        if (toSubmit != 0) enter(tail, toSubmit);
+    }
+
+    // A no-op completion, so the completion thread looks at its stop token
+    void wakeReaper() {
+        unsigned tail = std::atomic_ref(*_ring->sqTail).load(std::memory_order_relaxed);
+        io_uring_sqe& nop = nextSqe(tail);
+        nop.opcode = IORING_OP_NOP;
+        nop.user_data = WakeTag;
+        enter(tail, 1);
+    }
+
+    // Completion thread: hands written buffers back to the producer in submission order, and
+    // syncs what was asked for beyond the producer's own linked fsyncs (syncUpTo).
+    // Writes to a regular file only come up short on errors such as a full disk.
+    void reaperLoop(std::stop_token stop, std::uint64_t start) {
+        std::vector<Job> jobs(MaxBuffers);              // by sequence % MaxBuffers
+        std::vector<char> finished(MaxBuffers, 0);
+        std::uint64_t known = 0;                        // jobs taken off _jobs
+        std::uint64_t next = 0;                         // first job not handed back
+        std::uint64_t written = start;                  // everything before it is in the file
+        for (;;) {
+            unsigned head = std::atomic_ref(*_ring->cqHead).load(std::memory_order_relaxed);
+            const unsigned tail = std::atomic_ref(*_ring->cqTail).load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = _ring->cqes[head & _ring->cqMask];
+                if (cqe.user_data & WakeTag) continue;
+                if (cqe.user_data & SyncTag) {
+                    synced(cqe.user_data & ~SyncTag, cqe.res < 0 ? -cqe.res : 0);
+                    continue;
+                }
+                // The job was pushed before its write was submitted
+                for (Job job; known <= cqe.user_data; ++known) {
+                    while (!_jobs.tryPop(job)) cpuRelax();
+                    jobs[job.sequence % MaxBuffers] = job;
+                }
+                const std::size_t slot = cqe.user_data % MaxBuffers;
+                if (cqe.res < 0)                                              fail(-cqe.res);
+                else if (static_cast<std::uint64_t>(cqe.res) < jobs[slot].size) fail(EIO);
+                finished[slot] = 1;
+            }
+            std::atomic_ref(*_ring->cqHead).store(head, std::memory_order_release);
+
+            for (; next < known && finished[next % MaxBuffers]; ++next) {
+                const Job& job = jobs[next % MaxBuffers];
+                finished[next % MaxBuffers] = 0;
+                written = job.offset + job.size;
+                while (!_done.tryPush(Done{job.buffer, written})) std::this_thread::yield();
+            }
+            const std::uint64_t wanted = _syncWanted.load();
+            if (wanted > _syncIssued.load()) syncUpTo(wanted, written);
+            if (stop.stop_requested()) return;
+
+            // Sleep until the next completion. A sync asked for from here on comes with a no-op
+            // to wake us: either the producer sees this flag or we see its request (both
+            // sequentially consistent). One that can't be done yet waits for a write in flight.
+            _reaperWaiting.store(true);
+            if (_syncWanted.load() == wanted) ::syscall(__NR_io_uring_enter, _ring->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            _reaperWaiting.store(false);
+        }
+    }
+#else
+    bool setupRing() { return false; }
+    void teardownRing() {}
+    void queueOnRing(std::uint32_t, std::uint32_t, bool) {}
+    void wakeReaper() {}
+    void reaperLoop(std::stop_token, std::uint64_t) {}
+#endif
+
+    // ---- writer thread ----
+
+    // The job goes first: the writer thread only syncs what it has already taken
+    void queueOnThread(std::uint32_t buffer, std::uint32_t size, bool sync) {
+        if (size != 0) {
+            ++_pending;
+            while (!_jobs.tryPush(Job{buffer, size, _offset, 0})) std::this_thread::yield();    // can't happen: as many slots as buffers
+        }
+        if (sync) wantSync(_offset + size);
+        else      _wake.notify();
+    }
+
+    // Writes everything queued, then one fdatasync for all the syncs asked for meanwhile
+    void writerLoop(std::stop_token stop, std::uint64_t start) {
+        std::uint64_t written = start;
+        for (;;) {
+            const std::uint64_t wanted = _syncWanted.load(std::memory_order_acquire);
+            bool worked = false;
+            for (Job job; _jobs.tryPop(job); worked = true) {
+                writeOut(job.buffer, job.size, job.offset);
+                written = job.offset + job.size;
+                while (!_done.tryPush(Done{job.buffer, written})) std::this_thread::yield();
+            }
+            if (wanted > _syncedTo.load(std::memory_order_relaxed)) {
+                syncUpTo(wanted, written);
+                worked = true;
+            }
+            if (worked) {
+                _wake.busy();
+                continue;
+            }
+            if (stop.stop_requested()) return;
+            _wake.idle([&] {
+                return stop.stop_requested() || !_jobs.empty() ||
+                       _syncWanted.load(std::memory_order_acquire) > _syncedTo.load(std::memory_order_relaxed);
+            });
+        }
+    }
+
+    std::size_t                    _bufferSize;
+    std::size_t                    _bufferCount;
+    int                            _fd{-1};
+    std::unique_ptr<std::byte[]>   _memory;
+    std::vector<std::uint32_t>     _free;              // producer only
+    std::vector<std::uint64_t>     _base;              // per buffer, file offset of its first byte
+    std::uint32_t                  _current{NoBuffer}; // acquired, not yet submitted
+    std::uint64_t                  _offset{0};         // end of everything submitted
+    std::uint64_t                  _written{0};
+    std::size_t                    _pending{0};        // buffers still to come back
+    std::uint64_t                  _sequence{0};       // io_uring: next job's number
+    std::uint64_t                  _stalls{0};
+    std::atomic<std::uint64_t>     _syncWanted{0};     // producer: end of everything asked to be synced
+    std::atomic<std::uint64_t>     _syncIssued{0};     // producer: end covered by its last linked fsync
+    std::atomic<std::uint64_t>     _syncedTo{0};       // writer side: end of the last sync finished, failed or not
+    std::atomic<std::uint64_t>     _durable{0};
+    std::atomic<std::uint64_t>     _published{NoPublished};    // acquired buffer << 32 | bytes final in it
+    std::atomic<bool>              _reaperWaiting{false};
+    std::atomic<int>               _error{0};
+    ThreadPlacement                _placement{ThreadRole::JOURNAL};
+#if defined(__linux__)
+    std::optional<Ring>            _ring;
+#else
+    std::optional<int>             _ring;
+#endif
+    SpscRing<Job, MaxBuffers>      _jobs;              // producer -> writer / completion thread
+    SpscRing<Done, MaxBuffers>     _done;              // writer / completion thread -> producer
+    IdleWaiter                     _wake{WaitStrategy::SPIN_PARK};
+    std::jthread                   _writer;            // last: stopped before the rest goes
+};
+
+// What an AsyncWriterSink writes out
+enum class WriterStream {
+    JOURNAL,        // every outcome, as a journal file: Journal, replayJournal and recoverBook read it
+    TRADE_TAPE      // fills only, as raw EventRecords (the same records BinarySink writes)
+};
+
+// Streams a book's outcomes into an AsyncWriter's buffers. A full buffer is
+// handed over and the next one taken; the book's thread only ever copies records. With
+// `durable`, a unit of work (flush) asks for its records to be synced where they are, in the
+// part-filled buffer (AsyncWriter::syncThrough), and the writer group-commits them with the
+// other units synced meanwhile; the book never waits for the disk. It only waits if every buffer is still in flight, i.e. the disk can't keep up (see
+// AsyncWriter::stalls).
+// A JOURNAL stream starts an empty file with a JournalHeader and numbers its records from
+// `nextSequence`: to go on with an existing journal, pass what trimJournal returns for it.
+// With no writer it does nothing. Call finish() before the writer goes away.
+class AsyncWriterSink {
+public:
+    explicit AsyncWriterSink(AsyncWriter* writer = nullptr, WriterStream stream = WriterStream::JOURNAL, bool durable = false,
+                             std::uint64_t nextSequence = 1)
+            : _writer(writer), _stream(stream), _durable(durable), _sequence(nextSequence) {
+        if (_writer == nullptr) return;
+        if (_writer->bufferSize() < sizeof(JournalRecord)) {
+            throw std::invalid_argument("AsyncWriter buffers are too small for a journal record");
+        }
+        if (_stream == WriterStream::JOURNAL && _writer->submittedBytes() == 0) {
+            JournalHeader header;
+            header.firstSequence = nextSequence;
+            appendBytes(&header, sizeof(header));
+        }
+    }
+
+    void onFill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        append(EventRecord::fill(taker, resting, price, quantity));
+    }
+
+    void onRest(const Order& order) {
+        if (_stream == WriterStream::JOURNAL) append(EventRecord::rest(order));
+    }
+
+    void onModify(const Order& order) {
+        if (_stream == WriterStream::JOURNAL) append(EventRecord::modify(order));
+    }
+
+    void onCancel(OrderID id, Side side, Quantity quantity, CancelReason reason) {
+        if (_stream == WriterStream::JOURNAL) append(EventRecord::cancel(id, side, quantity, reason));
+    }
+
+    void onReject(const OrderRequest& request, CancelReason reason) {
+        if (_stream == WriterStream::JOURNAL) append(EventRecord::reject(request, reason));
+    }
+
+    void onOpenDay(Price todaysPrice) {
+        if (_stream == WriterStream::JOURNAL) append(EventRecord::openDay(todaysPrice));
+    }
+
+    void flush() {
+        if (_durable && _used != _syncedUsed) {
+            _writer->syncThrough(_used);
+            _syncedUsed = _used;
+        }
+    }
+
+    // Hand over whatever is buffered, e.g. at the end of a session
+    void finish() {
+        if (_used != 0) handOver(_durable);
+    }
+
+    [[nodiscard]] AsyncWriter* writer() const { return _writer; }
+
+private:
+    void append(const EventRecord& event) {
+        if (_writer == nullptr) return;
+        if (_stream == WriterStream::JOURNAL) {
+            JournalRecord record{};
+            record.sequence = _sequence++;
+            record.event = event;
+            appendBytes(&record, sizeof(record));
+        } else {
+            appendBytes(&event, sizeof(event));
+        }
+    }
+
+    void appendBytes(const void* bytes, std::size_t size) {
+        if (_buffer.size() - _used < size) {
+            if (_used != 0) handOver(false);
+            _buffer = _writer->acquire();
+        }
+        std::memcpy(_buffer.data() + _used, bytes, size);
+        _used += size;
+    }
+
+    void handOver(bool sync) {
+        _writer->submit(_used, sync);
+        _buffer = {};
+        _used = 0;
+        _syncedUsed = 0;
+    }
+
+    AsyncWriter*         _writer;
+    WriterStream         _stream;
+    bool                 _durable;
+    std::uint64_t        _sequence;     // JOURNAL: of the next record
+    std::span<std::byte> _buffer;       // acquired from the writer, _used bytes filled
+    std::size_t          _used{0};
+    std::size_t          _syncedUsed{0};    // of those, already asked to be synced
+};
+
+static_assert(EventSink<AsyncWriterSink>);
@@ -0,0 +1,19 @@
+#pragma once
+#include "priceladder.hpp"
+#include "denseladder.hpp"
+
+// A book backend picks the ladder type used for each side of an Orderbook.
+
+// Ordered map of levels: any price range, O(log L) level lookup.
+struct MapBackend {
+    template <Side S>
+    using Ladder = MapLadder<S>;
+};
+
+// Tick-indexed array of levels around today's price with bitmap best-price search.
+// Width is the band size in ticks; prices outside it still work via the spill maps.
+template <std::size_t Width = 4096>
+struct DenseBackend {
+    template <Side S>
+    using Ladder = DenseLadder<S, Width>;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include "ticksize.hpp"
+#include "orderpool.hpp"
+
+// Construction-time settings for an Orderbook
+struct BookConfig {
+    TickSize       tickSize{};
+
+    // Resting orders the book can hold without allocating
+    std::size_t    orderCapacity = 1 << 16;
+
+    // When all of orderCapacity is resting: REJECT cancels whatever would have rested
+    // (reported as "Book full"), GROW adds another orderCapacity of storage.
+    PoolExhaustion onPoolExhausted = PoolExhaustion::REJECT;
+
+    // High bits of every OrderID this book issues (see OrderIdGenerator). Books whose ids
+    // must not collide, like the books of one engine, need different partitions.
+    std::uint32_t  idPartition = 0;
+
+    // Seed of the book's own random generator, which populateOrderbook() / simulateNextDay()
+    // draw every synthetic day from. The same seed regenerates the same days bit-for-bit.
+    std::uint64_t  seed = 0;
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "order.hpp"
+
+// One resting order in a BookImage
+struct ImageOrder {
+    OrderID  orderId;
+    Price    price;
+    Quantity remaining;
+    Quantity original;
+    Side     side;
+};
+
+// Everything needed to rebuild a book: its resting orders in priority order (bids from the
+// best level down, then asks from the best level up; oldest first within a level), the last
+// OrderID it issued and today's price. Levels aren't stored, they follow from the orders.
+struct BookImage {
+    std::uint64_t           journalSequence{0};     // last journal record the image includes
+    Price                   todaysPrice{0};
+    OrderID                 lastOrderId{0};
+    std::vector<ImageOrder> orders;
+};
+
+// One order of an opening book loaded from outside (see bookloader.hpp): no id yet, the book
+// issues one as it places the order
+struct OpeningOrder {
+    Side     side;
+    Price    price;         // ticks
+    Quantity quantity;
+};
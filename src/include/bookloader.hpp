@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "bookimage.hpp"
+#include "mappedfile.hpp"
+#include "ticksize.hpp"
+
+// Opening book files, to start a day on a real book (BasicOrderbook::loadOpeningBook) instead
+// of populateOrderbook's synthetic one. Two forms, told apart by the first bytes:
+//
+//   CSV, one order per line in time priority:  side,price,quantity
+//     side is B / S / BUY / SELL (any case), price is decimal (converted with the book's
+//     TickSize), quantity a whole number. Blank lines and lines starting with # are skipped,
+//     as is a header line (first field "side", any case) ahead of the first order.
+//
+//   Binary: an OpeningBookHeader followed by raw OpeningOrders (prices in ticks).
+
+struct OpeningBookHeader {
+    char          magic[8]{'M', 'T', 'O', 'B', 'O', 'O', 'K', '1'};
+    std::uint32_t orderSize{sizeof(OpeningOrder)};
+    Price         todaysPrice{0};       // 0: the book takes the mid of the loaded touch
+    std::uint64_t orderCount{0};
+};
+
+inline void writeOpeningBook(const std::string& path, std::span<const OpeningOrder> orders, Price todaysPrice = 0) {
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) throw std::system_error(errno, std::generic_category(), "Cannot create " + path);
+    OpeningBookHeader header;
+    header.todaysPrice = todaysPrice;
+    header.orderCount = orders.size();
+    const bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                         (orders.empty() || std::fwrite(orders.data(), sizeof(OpeningOrder), orders.size(), out) == orders.size());
+    const int error = errno;
+    if (std::fclose(out) != 0 || !written) throw std::system_error(error, std::generic_category(), "Cannot write opening book " + path);
+}
+
+// Parse CSV opening book text into `out` (appended). Fields are parsed in place with
+// std::from_chars, without copying a line or allocating per order; `out` is reserved once from
+// the number of lines. Throws std::invalid_argument naming the line of the first bad order.
+inline void parseOpeningBookCsv(std::string_view text, const TickSize& tickSize, std::vector<OpeningOrder>& out) {
+    out.reserve(out.size() + static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1);
+
+    auto parseSide = [](std::string_view field, Side& side) {
+        if (field.empty() || field.size() > 4) return false;
+        char upper[4]{};
+        for (std::size_t i = 0; i < field.size(); ++i) {
+            upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(field[i])));
+        }
+        const std::string_view name(upper, field.size());
+        if (name == "B" || name == "BUY")  { side = Side::BUY;  return true; }
+        if (name == "S" || name == "SELL") { side = Side::SELL; return true; }
+        return false;
+    };
+
+    auto isHeader = [](std::string_view field) {
+        constexpr std::string_view name = "side";
+        return field.size() == name.size() &&
+               std::equal(field.begin(), field.end(), name.begin(), [](char a, char b) {
+                   return std::tolower(static_cast<unsigned char>(a)) == b;
+               });
+    };
+
+    std::size_t lineNumber = 0;
+    bool firstLine = true;
+    while (!text.empty()) {
+        const std::size_t end = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+        const bool header = std::exchange(firstLine, false);
+
+        auto fail = [&](const char* what) {
+            throw std::invalid_argument("Opening book line " + std::to_string(lineNumber) + ": " + what);
+        };
+        const std::size_t comma = line.find(',');
+        Side side{};
+        if (comma == std::string_view::npos || !parseSide(line.substr(0, comma), side)) {
+            if (header && isHeader(line.substr(0, comma))) continue;
+            fail("side must be B, S, BUY or SELL");
+        }
+
+        const char* first = line.data() + comma + 1;
+        const char* last = line.data() + line.size();
+        double price{};
+        auto parsed = std::from_chars(first, last, price);
+        if (parsed.ec != std::errc{} || parsed.ptr == last || *parsed.ptr != ',') fail("bad price");
+        Quantity quantity{};
+        parsed = std::from_chars(parsed.ptr + 1, last, quantity);
+        if (parsed.ec != std::errc{} || parsed.ptr != last) fail("bad quantity");
+        if (price <= 0.0 || quantity <= 0) fail("price and quantity must be > 0");
+
+        Price ticks{};
+        try {
+            ticks = tickSize.toTicks(price, side);
+        } catch (const std::invalid_argument& error) {
+            fail(error.what());                  // off the tick under TickRounding::REJECT
+        }
+        if (ticks <= 0) fail("price rounds to 0 ticks");
+
+        out.push_back(OpeningOrder{side, ticks, quantity});
+    }
+}
+
+// An opening book file (either form) mapped read-only. A binary file's orders are used straight
+// from the mapping; a CSV file is parsed once, when it is opened.
+class OpeningBookFile {
+public:
+    explicit OpeningBookFile(const std::string& path, const TickSize& tickSize = TickSize{}) : _file(path) {
+        OpeningBookHeader header;
+        if (_file.size() >= sizeof(header) &&
+            std::memcmp(_file.bytes().data(), header.magic, sizeof(header.magic)) == 0) {
+            std::memcpy(&header, _file.bytes().data(), sizeof(header));
+            if (header.orderSize != sizeof(OpeningOrder) ||
+                header.orderCount > (_file.size() - sizeof(header)) / sizeof(OpeningOrder)) {
+                throw std::invalid_argument("Not a complete opening book: " + path);
+            }
+            _todaysPrice = header.todaysPrice;
+            _orders = {reinterpret_cast<const OpeningOrder*>(_file.bytes().data() + sizeof(header)), header.orderCount};
+            for (std::size_t i = 0; i < _orders.size(); ++i) {
+                if (_orders[i].side != Side::BUY && _orders[i].side != Side::SELL) {
+                    throw std::invalid_argument("Opening book order " + std::to_string(i) + " has an unknown side: " + path);
+                }
+            }
+            _binary = true;
+        } else {
+            parseOpeningBookCsv(_file.text(), tickSize, _parsed);
+            _orders = _parsed;
+        }
+    }
+
+    [[nodiscard]] std::span<const OpeningOrder> orders() const { return _orders; }
+
+    // From a binary file's header; 0 (the mid of the loaded touch) for CSV
+    [[nodiscard]] Price todaysPrice() const { return _todaysPrice; }
+
+    [[nodiscard]] bool binary() const { return _binary; }
+
+private:
+    MappedFile                    _file;
+    std::vector<OpeningOrder>     _parsed;        // CSV only
+    std::span<const OpeningOrder> _orders;
+    Price                         _todaysPrice{0};
+    bool                          _binary{false};
+};
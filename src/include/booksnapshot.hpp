@@ -0,0 +1,166 @@
+#pragma once
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+#include "bookimage.hpp"
+#include "cpuaffinity.hpp"
+#include "journal.hpp"
+
+// Snapshot file: a fixed header followed by the image's orders as raw ImageOrder records
+struct SnapshotHeader {
+    char          magic[8]{'M', 'T', 'O', 'S', 'N', 'A', 'P', '1'};
+    std::uint32_t orderSize{sizeof(ImageOrder)};
+    std::uint64_t journalSequence{0};
+    Price         todaysPrice{0};
+    OrderID       lastOrderId{0};
+    std::uint64_t orderCount{0};
+};
+
+// Write `image` to `path` through a temporary file that is synced and then renamed over it,
+// so `path` always holds either the previous snapshot or this one, complete. Returns once the
+// rename is durable too (the directory is synced), so the journal it covers can be dropped.
+inline void writeSnapshot(const std::string& path, const BookImage& image) {
+    const std::string tempPath = path + ".tmp";
+    std::FILE* out = std::fopen(tempPath.c_str(), "wb");
+    if (out == nullptr) throw std::system_error(errno, std::generic_category(), "Cannot create " + tempPath);
+
+    SnapshotHeader header;
+    header.journalSequence = image.journalSequence;
+    header.todaysPrice = image.todaysPrice;
+    header.lastOrderId = image.lastOrderId;
+    header.orderCount = image.orders.size();
+    const bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                         (image.orders.empty() ||
+                          std::fwrite(image.orders.data(), sizeof(ImageOrder), image.orders.size(), out) == image.orders.size()) &&
+                         std::fflush(out) == 0 && ::fsync(::fileno(out)) == 0;
+    const int error = errno;
+    std::fclose(out);
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        throw std::system_error(written ? errno : error, std::generic_category(), "Cannot write snapshot " + path);
+    }
+    if (!syncParentDirectory(path)) throw std::system_error(errno, std::generic_category(), "Cannot sync the directory of snapshot " + path);
+}
+
+// The snapshot at `path`, or nullopt if there is none. Throws std::invalid_argument if the
+// file isn't a snapshot or is cut short.
+inline std::optional<BookImage> readSnapshot(const std::string& path) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (in == nullptr) return std::nullopt;
+
+    SnapshotHeader header;
+    BookImage image;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1 &&
+              std::memcmp(header.magic, SnapshotHeader{}.magic, sizeof(header.magic)) == 0 &&
+              header.orderSize == sizeof(ImageOrder);
+    if (ok) {
+        image.journalSequence = header.journalSequence;
+        image.todaysPrice = header.todaysPrice;
+        image.lastOrderId = header.lastOrderId;
+        image.orders.resize(header.orderCount);
+        ok = image.orders.empty() ||
+             std::fread(image.orders.data(), sizeof(ImageOrder), image.orders.size(), in) == image.orders.size();
+    }
+    std::fclose(in);
+    if (!ok) throw std::invalid_argument("Not a complete snapshot: " + path);
+    return image;
+}
+
+// Periodic snapshots of a journaled book, for fast restarts: load the latest snapshot and
+// replay only the journal records after it (see recoverBook).
+//
+// snapshot() runs on the book's thread between commands, which is what makes the copy
+// consistent: it captures the book into memory, with no I/O, and tags it with the last journal
+// record so far. A background thread writes it out. Once that write is durable, poll() (again
+// on the book's thread) truncates the journal up to the tagged record. That truncation is the
+// one part that blocks on the disk, and it stays on the book's thread because the journal is
+// appended there. The writing thread is persistence work: give it the CPUs of the JOURNAL role
+// (CoreLayout::journal), if any.
+template <typename Book>
+class BookSnapshotter {
+public:
+    BookSnapshotter(Book& book, Journal& journal, std::string path, CpuSet cpus = {})
+            : _book(book), _journal(journal), _path(std::move(path)), _cpus(std::move(cpus)) {}
+
+    // A snapshot still being written is finished, but the journal is left as it is
+    ~BookSnapshotter() {
+        if (_writing.valid()) _writing.wait();
+    }
+
+    BookSnapshotter(const BookSnapshotter&) = delete;
+    BookSnapshotter& operator=(const BookSnapshotter&) = delete;
+
+    // Start a snapshot. False if the previous one is still being written.
+    bool snapshot() {
+        if (_writing.valid() && !poll()) return false;
+        BookImage image;
+        image.orders.reserve(_lastOrderCount);
+        _book.capture(image);
+        image.journalSequence = _journal.lastSequence();
+        _lastOrderCount = image.orders.size();
+        _writingSequence = image.journalSequence;
+        _writing = std::async(std::launch::async, [path = _path, cpus = _cpus, image = std::move(image)] {
+            if (!cpus.empty()) pinThisThread(cpus);
+            writeSnapshot(path, image);
+        });
+        return true;
+    }
+
+    // If the snapshot being written is done, truncate the journal up to it. True if it did.
+    // Rethrows if writing the snapshot failed (the journal is then left as it is).
+    // Stalls the calling thread when it truncates: Journal::truncate copies the records kept,
+    // msyncs them and renames the file over the journal with a directory fsync, a few ms on a
+    // disk. Journal isn't thread-safe, so this can't move to the writing thread while the book
+    // appends. Call it where the book can afford that, e.g. between bursts, not per command.
+    bool poll() {
+        if (!_writing.valid() || _writing.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        _writing.get();
+        _journal.truncate(_writingSequence);
+        ++_completed;
+        return true;
+    }
+
+    // Block until the snapshot being written is done, then poll()
+    void finish() {
+        if (!_writing.valid()) return;
+        _writing.wait();
+        poll();
+    }
+
+    [[nodiscard]] bool writing() const { return _writing.valid(); }
+
+    // Snapshots written and journal truncations done
+    [[nodiscard]] std::uint64_t completed() const { return _completed; }
+
+    [[nodiscard]] const std::string& path() const { return _path; }
+
+private:
+    Book&             _book;
+    Journal&          _journal;
+    std::string       _path;
+    CpuSet            _cpus;
+    std::future<void> _writing;
+    std::uint64_t     _writingSequence{0};
+    std::size_t       _lastOrderCount{0};
+    std::uint64_t     _completed{0};
+};
+
+// Restart: restore `book` (new, set up like the one that wrote them) from the snapshot at
+// `snapshotPath` if there is one, then replay the journal records after it.
+// Returns the number of journal records replayed.
+template <typename Book>
+std::size_t recoverBook(Book& book, const std::string& snapshotPath, const Journal& journal) {
+    std::uint64_t after = 0;
+    if (const auto image = readSnapshot(snapshotPath)) {
+        book.restore(*image);
+        after = image->journalSequence;
+    }
+    return replayJournal(journal, book, after);
+}
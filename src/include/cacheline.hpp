@@ -0,0 +1,7 @@
+#pragma once
+#include <cstddef>
+
+// Alignment that keeps data written by different threads on different cache lines.
+// 64 bytes on x86-64 and most ARM cores; fixed rather than taken from
+// std::hardware_destructive_interference_size so the layout doesn't change with compiler flags.
+inline constexpr std::size_t CacheLineSize = 64;
@@ -5,5 +5,7 @@ enum Choice {
     LIMIT,
     SIMULATE_DAY,
     DISPLAY_ORDERBOOK,
+    CANCEL_ORDER,
+    MODIFY_ORDER,
     EXIT
 };
\ No newline at end of file
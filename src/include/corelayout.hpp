@@ -0,0 +1,173 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "cpuaffinity.hpp"
+
+// What a thread does, for deciding where it runs
+enum class ThreadRole : std::uint8_t {
+    MATCHING,       // engine shard threads
+    GATEWAY,        // client I/O, posting commands into the engine
+    JOURNAL,        // write-ahead log writers
+    MARKET_DATA     // depth / report publishers
+};
+
+inline std::string_view roleName(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::MATCHING:    return "matching";
+        case ThreadRole::GATEWAY:     return "gateway";
+        case ThreadRole::JOURNAL:     return "journal";
+        case ThreadRole::MARKET_DATA: return "marketdata";
+    }
+    return "unknown";
+}
+
+// "0-3,6" style list of a CPU set, as taskset and /proc print them
+inline std::string formatCpus(const CpuSet& cpus) {
+    std::string out;
+    for (std::size_t i = 0; i < cpus.size();) {
+        std::size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!out.empty()) out += ',';
+        out += std::to_string(cpus[i]);
+        if (j > i) out += '-' + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out.empty() ? "-" : out;
+}
+
+// Where one thread was asked to run and where it actually may run
+struct ThreadPlacement {
+    ThreadRole  role{ThreadRole::MATCHING};
+    std::size_t index{0};       // thread number within its role (shard number for MATCHING)
+    CpuSet      requested{};    // empty: not pinned by configuration
+    CpuSet      effective{};    // the thread's affinity after pinning, read back from the OS
+    bool        pinned{false};  // the requested set was applied
+};
+
+// Which CPUs each role's threads run on, e.g. from a startup flag:
+//
+//     matching=2-5,8;gateway=1;journal=0;marketdata=0
+//
+// MATCHING threads get one CPU each: shard i runs on matching[i % size], so a shard never
+// shares its core with another unless there are more shards than CPUs. The other roles are
+// pinned to their whole set and left to the scheduler within it. The placement of a thread is
+// a function of the layout and its (role, index) only, so the same layout puts every thread on
+// the same CPU on every run. A role with an empty set isn't pinned.
+struct CoreLayout {
+    CpuSet matching{};
+    CpuSet gateway{};
+    CpuSet journal{};
+    CpuSet marketData{};
+
+    [[nodiscard]] bool empty() const {
+        return matching.empty() && gateway.empty() && journal.empty() && marketData.empty();
+    }
+
+    [[nodiscard]] const CpuSet& cpusFor(ThreadRole role) const {
+        switch (role) {
+            case ThreadRole::MATCHING:    return matching;
+            case ThreadRole::GATEWAY:     return gateway;
+            case ThreadRole::JOURNAL:     return journal;
+            case ThreadRole::MARKET_DATA: return marketData;
+        }
+        return matching;
+    }
+
+    [[nodiscard]] CpuSet& cpusFor(ThreadRole role) {
+        return const_cast<CpuSet&>(static_cast<const CoreLayout&>(*this).cpusFor(role));
+    }
+
+    // CPUs thread `index` of `role` should run on
+    [[nodiscard]] CpuSet placementFor(ThreadRole role, std::size_t index) const {
+        const CpuSet& cpus = cpusFor(role);
+        if (cpus.empty() || role != ThreadRole::MATCHING) return cpus;
+        return CpuSet{cpus[index % cpus.size()]};
+    }
+
+    // Pin the calling thread as thread `index` of `role` and report where it ended up
+    [[nodiscard]] ThreadPlacement apply(ThreadRole role, std::size_t index) const {
+        return placeThisThread(role, index, placementFor(role, index));
+    }
+
+    // Pin the calling thread to `cpus` (nothing if empty) and report where it ended up
+    static ThreadPlacement placeThisThread(ThreadRole role, std::size_t index, CpuSet cpus) {
+        ThreadPlacement placement{role, index, std::move(cpus)};
+        placement.pinned = !placement.requested.empty() && pinThisThread(placement.requested);
+        placement.effective = currentAffinity();
+        return placement;
+    }
+
+    // Throws std::invalid_argument on an unknown role, a malformed list or a repeated role
+    static CoreLayout parse(std::string_view spec) {
+        CoreLayout layout;
+        bool seen[4]{};
+        while (!spec.empty()) {
+            const std::size_t end = spec.find(';');
+            const std::string_view entry = spec.substr(0, end);
+            spec = end == std::string_view::npos ? std::string_view{} : spec.substr(end + 1);
+            if (entry.empty()) continue;
+
+            const std::size_t eq = entry.find('=');
+            if (eq == std::string_view::npos) throw std::invalid_argument("Core layout entry needs role=cpus: " + std::string(entry));
+            const ThreadRole role = parseRole(entry.substr(0, eq));
+            if (seen[static_cast<int>(role)]) throw std::invalid_argument("Core layout repeats role: " + std::string(entry.substr(0, eq)));
+            seen[static_cast<int>(role)] = true;
+            layout.cpusFor(role) = parseCpus(entry.substr(eq + 1));
+        }
+        return layout;
+    }
+
+    // "0-3,6" -> {0, 1, 2, 3, 6}, in the order written
+    static CpuSet parseCpus(std::string_view list) {
+        CpuSet cpus;
+        while (!list.empty()) {
+            const std::size_t end = list.find(',');
+            const std::string_view range = list.substr(0, end);
+            list = end == std::string_view::npos ? std::string_view{} : list.substr(end + 1);
+
+            const std::size_t dash = range.find('-');
+            const unsigned first = parseCpu(range.substr(0, dash));
+            const unsigned last = dash == std::string_view::npos ? first : parseCpu(range.substr(dash + 1));
+            if (last < first) throw std::invalid_argument("Bad CPU range: " + std::string(range));
+            for (unsigned cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+        if (cpus.empty()) throw std::invalid_argument("Empty CPU list");
+        return cpus;
+    }
+
+private:
+    static ThreadRole parseRole(std::string_view name) {
+        for (ThreadRole role : {ThreadRole::MATCHING, ThreadRole::GATEWAY, ThreadRole::JOURNAL, ThreadRole::MARKET_DATA}) {
+            if (name == roleName(role)) return role;
+        }
+        throw std::invalid_argument("Unknown thread role: " + std::string(name));
+    }
+
+    static unsigned parseCpu(std::string_view text) {
+        unsigned cpu = 0;
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+        if (ec != std::errc{} || end != text.data() + text.size() || text.empty()) {
+            throw std::invalid_argument("Bad CPU number: " + std::string(text));
+        }
+        if (cpu >= MaxCpus) {
+            throw std::invalid_argument("CPU number out of range: " + std::string(text) + " (at most " + std::to_string(MaxCpus - 1) + ")");
+        }
+        return cpu;
+    }
+
+};
+
+// One line per thread: role, index, requested and effective CPUs
+inline void printLayout(std::ostream& out, std::span<const ThreadPlacement> placements) {
+    for (const auto& placement : placements) {
+        out << "  " << roleName(placement.role) << '[' << placement.index << "]: requested "
+            << formatCpus(placement.requested) << ", running on " << formatCpus(placement.effective)
+            << (placement.requested.empty() || placement.pinned ? "" : " (pinning failed)") << '\n';
+    }
+}
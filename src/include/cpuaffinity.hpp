@@ -0,0 +1,57 @@
+#pragma once
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// CPU numbers, as used by sched_setaffinity
+using CpuSet = std::vector<unsigned>;
+
+// One past the highest CPU number a CpuSet can name (the size of a cpu_set_t)
+#if defined(__linux__)
+inline constexpr unsigned MaxCpus = CPU_SETSIZE;
+#else
+inline constexpr unsigned MaxCpus = 1024;
+#endif
+
+// Number of CPUs to spread threads over, at least 1
+inline unsigned cpuCount() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Restrict the calling thread to `cpus`. False if the platform doesn't support it or none of
+// the CPUs is available to this process (the thread then keeps its current affinity).
+inline bool pinThisThread(const CpuSet& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus) {
+        if (cpu >= MaxCpus) return false;
+        CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// Pin the calling thread to one CPU
+inline bool pinThisThread(unsigned cpu) { return pinThisThread(CpuSet{cpu}); }
+
+// CPUs the calling thread may run on right now (empty if the platform can't tell)
+inline CpuSet currentAffinity() {
+    CpuSet cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+    for (unsigned cpu = 0; cpu < MaxCpus; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
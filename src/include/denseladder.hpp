@@ -0,0 +1,188 @@
+#pragma once
+#include <map>
+#include <vector>
+#include "side.hpp"
+#include "pricelevel.hpp"
+#include "occupancybitmap.hpp"
+
+// One side of the book as a contiguous array of price levels, one slot per tick in
+// [anchor, anchor + Width), plus an occupancy bitmap over the slots.
+// Finding a level in the band is an array index and the best / next level is a bitmap scan,
+// so nothing here is O(log L). Prices outside the band spill into two sparse maps
+// (below and above the band) that keep the same interface working for outliers.
+//
+// Same interface as MapLadder so the two can be swapped via the book backend.
+template <Side S, std::size_t Width = 4096>
+class DenseLadder {
+public:
+    static constexpr std::size_t npos = OccupancyBitmap<Width>::npos;
+
+    DenseLadder() : _slots(Width) {}
+
+    [[nodiscard]] bool empty() const { return _levelCount == 0; }
+
+    [[nodiscard]] std::size_t levelCount() const { return _levelCount; }
+
+    [[nodiscard]] std::size_t spilledLevelCount() const { return _below.size() + _above.size(); }
+
+    [[nodiscard]] Price anchor() const { return _anchor; }
+
+    PriceLevel* best() {
+        if constexpr (S == Side::BUY) return highest();
+        else                          return lowest();
+    }
+
+    PriceLevel* find(Price price) {
+        if (inBand(price)) {
+            const std::size_t slot = slotOf(price);
+            return _occupied.test(slot) ? &_slots[slot] : nullptr;
+        }
+        auto& spill = spillFor(price);
+        auto it = spill.find(price);
+        return it == spill.end() ? nullptr : &it->second;
+    }
+
+    // Level at `price`, created empty if it doesn't exist yet
+    PriceLevel& levelFor(Price price) {
+        if (inBand(price)) {
+            const std::size_t slot = slotOf(price);
+            if (!_occupied.test(slot)) {
+                _occupied.set(slot);
+                _slots[slot].price = price;
+                ++_levelCount;
+            }
+            return _slots[slot];
+        }
+        auto [it, inserted] = spillFor(price).try_emplace(price);
+        if (inserted) {
+            it->second.price = price;
+            ++_levelCount;
+        }
+        return it->second;
+    }
+
+    void erase(Price price) {
+        if (inBand(price)) {
+            const std::size_t slot = slotOf(price);
+            if (!_occupied.test(slot)) return;
+            _occupied.reset(slot);
+            _slots[slot] = PriceLevel{};
+            --_levelCount;
+            return;
+        }
+        _levelCount -= spillFor(price).erase(price);
+    }
+
+    void clear() {
+        for (std::size_t slot = _occupied.first(); slot != npos; slot = _occupied.nextAbove(slot)) {
+            _slots[slot] = PriceLevel{};
+        }
+        _occupied.clear();
+        _below.clear();
+        _above.clear();
+        _levelCount = 0;
+    }
+
+    // Move the band so that it is centered on `center`. Levels are carried over,
+    // ones that fall out of the new band go to the spill maps and vice versa.
+    // Invalidates PriceLevel pointers.
+    void recenter(Price center) {
+        const Price anchor = center - static_cast<Price>(Width / 2);
+        if (anchor == _anchor) return;
+
+        std::vector<PriceLevel> levels;
+        levels.reserve(_levelCount);
+        forEachAscending(*this, [&](PriceLevel& level) { levels.push_back(std::move(level)); });
+
+        clear();
+        _anchor = anchor;
+        for (auto& level : levels) {
+            Price price = level.price;
+            levelFor(price) = std::move(level);
+        }
+    }
+
+    template <typename F>
+    void forEachBestFirst(F&& f) const {
+        if constexpr (S == Side::BUY) forEachDescending(*this, f);
+        else                          forEachAscending(*this, f);
+    }
+
+    // Best level first while `f` returns true
+    template <typename F>
+    void forEachBestFirstWhile(F&& f) const {
+        if constexpr (S == Side::BUY) descendingWhile(*this, f);
+        else                          ascendingWhile(*this, f);
+    }
+
+    template <typename F>
+    void forEachWorstFirst(F&& f) const {
+        if constexpr (S == Side::BUY) forEachAscending(*this, f);
+        else                          forEachDescending(*this, f);
+    }
+
+private:
+    using Spill = std::map<Price, PriceLevel>;
+
+    [[nodiscard]] bool inBand(Price price) const {
+        return price >= _anchor && price < _anchor + static_cast<Price>(Width);
+    }
+
+    [[nodiscard]] std::size_t slotOf(Price price) const { return static_cast<std::size_t>(price - _anchor); }
+
+    Spill& spillFor(Price price) { return price < _anchor ? _below : _above; }
+
+    // Prices ascend from _below through the band to _above
+    PriceLevel* lowest() {
+        if (!_below.empty()) return &_below.begin()->second;
+        if (std::size_t slot = _occupied.first(); slot != npos) return &_slots[slot];
+        if (!_above.empty()) return &_above.begin()->second;
+        return nullptr;
+    }
+
+    PriceLevel* highest() {
+        if (!_above.empty()) return &_above.rbegin()->second;
+        if (std::size_t slot = _occupied.last(); slot != npos) return &_slots[slot];
+        if (!_below.empty()) return &_below.rbegin()->second;
+        return nullptr;
+    }
+
+    // Self is DenseLadder or const DenseLadder, so one body serves both constnesses.
+    // The *While walks stop as soon as `f` returns false and report whether they ran to the end.
+    template <typename Self, typename F>
+    static bool ascendingWhile(Self& self, F&& f) {
+        for (auto& [price, level] : self._below) if (!f(level)) return false;
+        for (std::size_t slot = self._occupied.first(); slot != npos; slot = self._occupied.nextAbove(slot)) {
+            if (!f(self._slots[slot])) return false;
+        }
+        for (auto& [price, level] : self._above) if (!f(level)) return false;
+        return true;
+    }
+
+    template <typename Self, typename F>
+    static bool descendingWhile(Self& self, F&& f) {
+        for (auto it = self._above.rbegin(); it != self._above.rend(); ++it) if (!f(it->second)) return false;
+        for (std::size_t slot = self._occupied.last(); slot != npos; slot = self._occupied.nextBelow(slot)) {
+            if (!f(self._slots[slot])) return false;
+        }
+        for (auto it = self._below.rbegin(); it != self._below.rend(); ++it) if (!f(it->second)) return false;
+        return true;
+    }
+
+    template <typename Self, typename F>
+    static void forEachAscending(Self& self, F&& f) {
+        ascendingWhile(self, [&](auto& level) { f(level); return true; });
+    }
+
+    template <typename Self, typename F>
+    static void forEachDescending(Self& self, F&& f) {
+        descendingWhile(self, [&](auto& level) { f(level); return true; });
+    }
+
+    std::vector<PriceLevel>  _slots;
+    OccupancyBitmap<Width>   _occupied;
+    Spill                    _below;
+    Spill                    _above;
+    Price                    _anchor{0};
+    std::size_t              _levelCount{0};
+};
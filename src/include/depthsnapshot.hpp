@@ -0,0 +1,22 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "order.hpp"
+
+// One aggregated price level as seen by market data readers
+struct DepthLevel {
+    Price         price{0};
+    Quantity      quantity{0};
+    std::uint32_t orderCount{0};
+};
+
+// Top `Depth` levels of both sides (L2; level 0 is L1), best first.
+// Plain data so it can be published through a Seqlock.
+template <std::size_t Depth>
+struct DepthSnapshot {
+    std::uint64_t                     sequence{0};     // producer-defined, e.g. last command applied
+    std::uint32_t                     bidLevels{0};    // valid entries in bids
+    std::uint32_t                     askLevels{0};    // valid entries in asks
+    std::array<DepthLevel, Depth>     bids{};
+    std::array<DepthLevel, Depth>     asks{};
+};
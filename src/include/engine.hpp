@@ -0,0 +1,395 @@
+#pragma once
+#include <atomic>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "orderbook.hpp"
+#include "cpuaffinity.hpp"
+#include "corelayout.hpp"
+#include "spscring.hpp"
+#include "mpscring.hpp"
+#include "seqlock.hpp"
+#include "waitstrategy.hpp"
+
+using SymbolId = std::uint32_t;
+
+// One instrument traded by the engine
+struct SymbolSpec {
+    std::string name;
+    Price       referencePrice{0};      // ticks; dense ladders are centered here
+    BookConfig  book{};
+};
+
+struct EngineConfig {
+    std::size_t shardCount{cpuCount()};
+    bool        pinThreads{true};       // shard i runs on CPU (firstCpu + i) % cpuCount()
+    unsigned    firstCpu{0};
+    CoreLayout  layout{};               // if layout.matching is set, shard i runs on layout.placementFor(MATCHING, i) instead
+    bool        publishReports{false};  // shards send a ReportMessage per command, see pollReports()
+    bool        publishDepth{false};    // shards publish a depth snapshot per changed book, see depth()
+
+    // How idle shard threads wait for commands: waitStrategy for every shard, unless
+    // shardWaitStrategies has an entry for it (e.g. BUSY_SPIN for the first, latency-critical
+    // shards on dedicated cores and SPIN_PARK for the long tail on shared ones)
+    WaitStrategy              waitStrategy{WaitStrategy::SPIN_YIELD};
+    std::vector<WaitStrategy> shardWaitStrategies{};
+
+    [[nodiscard]] WaitStrategy waitStrategyFor(std::size_t shard) const {
+        return shard < shardWaitStrategies.size() ? shardWaitStrategies[shard] : waitStrategy;
+    }
+};
+
+// A unit of work for the shard that owns `symbol`
+struct EngineCommand {
+    enum class Kind : std::uint8_t { SUBMIT, CANCEL, MODIFY };
+
+    Kind         kind{Kind::SUBMIT};
+    SymbolId     symbol{0};
+    OrderRequest request{};         // SUBMIT
+    OrderID      orderId{0};        // CANCEL, MODIFY
+    Quantity     quantity{0};       // MODIFY: new open quantity
+    Price        price{0};          // MODIFY: new limit price
+    std::uint64_t tag{0};           // caller's correlation id, echoed in the ReportMessage
+};
+
+// Fixed-size outcome of one EngineCommand, handed back from the shard thread.
+// SUBMIT: the order's ExecutionReport without the individual fills (those go to the sink).
+// CANCEL: CANCELED / USER_REQUESTED, or REJECTED / INVALID_ORDER for an unknown id.
+// MODIFY: RESTING when amended in place, the re-entry's outcome when replaced,
+//         or REJECTED / INVALID_ORDER for an unknown id or bad values.
+struct ReportMessage {
+    std::uint64_t       tag{0};
+    std::uint64_t       sequence{0};    // arrival sequence of the command at its shard
+    OrderID             orderId{0};
+    SymbolId            symbol{0};
+    EngineCommand::Kind kind{EngineCommand::Kind::SUBMIT};
+    OrderStatus         status{OrderStatus::REJECTED};
+    CancelReason        cancelReason{CancelReason::NONE};
+    Quantity            filledQuantity{0};
+    Quantity            restingQuantity{0};
+    Quantity            canceledQuantity{0};
+    Price               notional{0};
+};
+
+// Many order books, one per symbol, split over shard threads.
+// Every symbol belongs to exactly one shard and only that shard's thread ever touches its book,
+// so books need no locking. Symbols are assigned round-robin at construction and the
+// symbol -> (shard, slot) table never changes afterwards, so routing is a plain read of
+// immutable data from any thread. Each shard thread is pinned to its own CPU and builds
+// its books itself, so their memory is first touched (and placed) on that CPU.
+//
+// Any number of threads may post(): commands reach a shard through an MPSC ring that stamps
+// each one with its arrival sequence, and the shard applies them strictly in that order, so
+// price-time priority is well defined however many sessions submit at once. Reports come back
+// through an SPSC ring per shard, read by one consumer thread with pollReports().
+// With publishDepth, each shard republishes the top levels of every book a batch changed
+// through a Seqlock, and any number of reader threads take consistent copies without locks.
+template <typename Backend = MapBackend, EventSink Sink = NullSink>
+class BasicEngine {
+public:
+    using Book = BasicOrderbook<Backend, Sink>;
+    static constexpr std::size_t SnapshotDepth = 10;
+    using Snapshot = DepthSnapshot<SnapshotDepth>;
+
+    explicit BasicEngine(const std::vector<SymbolSpec>& symbols, EngineConfig config = EngineConfig{}, Sink sink = Sink{}) {
+        if (config.shardCount == 0) throw std::invalid_argument("Engine needs at least one shard");
+        if (symbols.size() > OrderIdGenerator::MaxPartition + std::size_t{1}) throw std::invalid_argument("Too many symbols");
+        _publishReports = config.publishReports;
+        _publishDepth = config.publishDepth;
+
+        _routes.reserve(symbols.size());
+        for (const auto& spec : symbols) {
+            const auto id = static_cast<SymbolId>(_routes.size());
+            if (!_symbolIds.try_emplace(spec.name, id).second) {
+                throw std::invalid_argument("Duplicate symbol: " + spec.name);
+            }
+            _routes.push_back(Route{static_cast<std::uint32_t>(id % config.shardCount),
+                                    static_cast<std::uint32_t>(id / config.shardCount)});
+        }
+
+        _shards.reserve(config.shardCount);
+        for (std::size_t i = 0; i < config.shardCount; ++i) _shards.push_back(std::make_unique<Shard>(config.waitStrategyFor(i)));
+
+        std::latch ready(static_cast<std::ptrdiff_t>(config.shardCount));
+        for (std::size_t i = 0; i < config.shardCount; ++i) {
+            Shard& shard = *_shards[i];
+            CpuSet cpus;
+            if (!config.layout.matching.empty()) cpus = config.layout.placementFor(ThreadRole::MATCHING, i);
+            else if (config.pinThreads)          cpus = CpuSet{static_cast<unsigned>((config.firstCpu + i) % cpuCount())};
+            shard.thread = std::jthread([this, &shard, &symbols, &ready, &sink, i, cpus](std::stop_token stop) {
+                shard.placement = CoreLayout::placeThisThread(ThreadRole::MATCHING, i, cpus);
+                for (std::size_t id = i; id < symbols.size(); id += _shards.size()) {
+                    BookConfig bookConfig = symbols[id].book;
+                    bookConfig.idPartition = static_cast<std::uint32_t>(id);     // OrderIDs carry their symbol
+                    shard.books.push_back(std::make_unique<Book>(bookConfig, sink));
+                    shard.books.back()->recenter(symbols[id].referencePrice);
+                    shard.snapshots.push_back(std::make_unique<Seqlock<Snapshot>>());
+                }
+                shard.changed.assign(shard.books.size(), false);
+                shard.lastSequence.assign(shard.books.size(), 0);
+                shard.changedSlots.reserve(BatchSize);
+                ready.count_down();
+                run(shard, stop);
+            });
+        }
+        ready.wait();
+    }
+
+    // Stops the shard threads; commands not yet processed are dropped (call drain() first)
+    ~BasicEngine() {
+        for (auto& shard : _shards) {
+            shard->thread.request_stop();
+            shard->waiter.ring();
+        }
+    }
+
+    BasicEngine(const BasicEngine&) = delete;
+    BasicEngine& operator=(const BasicEngine&) = delete;
+
+    [[nodiscard]] std::optional<SymbolId> lookup(std::string_view name) const {
+        auto it = _symbolIds.find(name);
+        if (it == _symbolIds.end()) return std::nullopt;
+        return it->second;
+    }
+
+    [[nodiscard]] std::size_t symbolCount() const { return _routes.size(); }
+
+    [[nodiscard]] std::size_t shardCount() const { return _shards.size(); }
+
+    [[nodiscard]] std::size_t shardOf(SymbolId symbol) const { return _routes.at(symbol).shard; }
+
+    // Every OrderID issued by the engine carries the SymbolId of its book, so the owner of an
+    // order is known from the id alone
+    [[nodiscard]] static SymbolId symbolOfOrder(OrderID orderId) { return OrderIdGenerator::partitionOf(orderId); }
+
+    [[nodiscard]] std::size_t shardOfOrder(OrderID orderId) const { return shardOf(symbolOfOrder(orderId)); }
+
+    // CPU the shard's thread is pinned to, -1 if it isn't pinned
+    [[nodiscard]] int shardCpu(std::size_t shard) const {
+        const ThreadPlacement& placement = _shards.at(shard)->placement;
+        return placement.pinned && placement.requested.size() == 1 ? static_cast<int>(placement.requested.front()) : -1;
+    }
+
+    // Where each shard thread was asked to run and where it runs, by shard
+    [[nodiscard]] std::vector<ThreadPlacement> placements() const {
+        std::vector<ThreadPlacement> out;
+        out.reserve(_shards.size());
+        for (const auto& shard : _shards) out.push_back(shard->placement);
+        return out;
+    }
+
+    [[nodiscard]] WaitStrategy shardWaitStrategy(std::size_t shard) const { return _shards.at(shard)->waiter.strategy(); }
+
+    // Hand a command to the owning shard, from any thread. Returns its arrival sequence at
+    // that shard, which is the order it is applied in; spins while the shard's inbox is full.
+    std::uint64_t post(const EngineCommand& command) {
+        Shard& shard = *_shards[_routes.at(command.symbol).shard];
+        for (;;) {
+            if (auto sequence = shard.inbox.tryPush(command)) {
+                shard.waiter.notify();
+                return *sequence;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    std::uint64_t submit(SymbolId symbol, const OrderRequest& request) {
+        return post(EngineCommand{EngineCommand::Kind::SUBMIT, symbol, request});
+    }
+
+    std::uint64_t cancel(SymbolId symbol, OrderID orderId) {
+        return post(EngineCommand{EngineCommand::Kind::CANCEL, symbol, {}, orderId});
+    }
+
+    // Same, routed by the symbol encoded in the id
+    std::uint64_t cancel(OrderID orderId) { return cancel(symbolOfOrder(orderId), orderId); }
+
+    std::uint64_t modify(SymbolId symbol, OrderID orderId, Quantity quantity, Price price) {
+        return post(EngineCommand{EngineCommand::Kind::MODIFY, symbol, {}, orderId, quantity, price});
+    }
+
+    // Collect reports from all shards into `out`, returns how many. Only with publishReports,
+    // from one consumer thread, which must keep polling: a shard waits while its outbox is full.
+    std::size_t pollReports(std::span<ReportMessage> out) {
+        std::size_t n = 0;
+        for (auto& shard : _shards) {
+            if (n == out.size()) break;
+            n += shard->outbox.popBatch(out.subspan(n));
+        }
+        return n;
+    }
+
+    // Latest depth snapshot of `symbol` (all levels empty until its book first changes, and
+    // always without publishDepth). Any thread, never blocks the shard.
+    [[nodiscard]] Snapshot depth(SymbolId symbol) const {
+        const Route& route = _routes.at(symbol);
+        return _shards[route.shard]->snapshots[route.slot]->load();
+    }
+
+    // Wait until every command posted so far has been applied. With publishReports the
+    // reports must be polled meanwhile, or a shard with a full outbox never gets there.
+    void drain() const {
+        for (const auto& shard : _shards) {
+            const std::uint64_t claimed = shard->inbox.claimed();
+            while (shard->processed.load(std::memory_order_acquire) < claimed) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Commands applied by all shards so far
+    [[nodiscard]] std::uint64_t processed() const {
+        std::uint64_t total = 0;
+        for (const auto& shard : _shards) total += shard->processed.load(std::memory_order_acquire);
+        return total;
+    }
+
+    // The book of `symbol`. Only safe to use while the engine is quiescent (after drain(),
+    // with no concurrent post()), since the shard thread owns it otherwise.
+    [[nodiscard]] Book& book(SymbolId symbol) {
+        const Route& route = _routes.at(symbol);
+        return *_shards[route.shard]->books[route.slot];
+    }
+
+private:
+    struct Route {
+        std::uint32_t shard;
+        std::uint32_t slot;     // index of the book within its shard
+    };
+
+    static constexpr std::size_t InboxCapacity = 4096;
+    static constexpr std::size_t OutboxCapacity = 4096;
+    static constexpr std::size_t BatchSize = 64;       // commands taken off the inbox at a time
+
+    struct Shard {
+        explicit Shard(WaitStrategy strategy) : waiter(strategy) {}
+
+        std::vector<std::unique_ptr<Book>>          books;
+        MpscRing<EngineCommand, InboxCapacity>      inbox;
+        SpscRing<ReportMessage, OutboxCapacity>     outbox;
+        std::vector<std::unique_ptr<Seqlock<Snapshot>>> snapshots;  // by slot, like books
+        std::vector<bool>                           changed;        // by slot, in the current batch
+        std::vector<std::uint64_t>                  lastSequence;   // by slot, last command applied
+        std::vector<std::uint32_t>                  changedSlots;
+        ThreadPlacement                             placement;      // written before `ready`
+        IdleWaiter                                  waiter;
+        alignas(CacheLineSize) std::atomic<std::uint64_t> processed{0};  // written by the shard thread
+        std::jthread                                thread;     // last: joined before the rest is destroyed
+    };
+
+    // Lets _symbolIds be searched with a string_view without building a std::string
+    struct SymbolHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    void run(Shard& shard, std::stop_token stop) {
+        std::array<EngineCommand, BatchSize> batch;
+        std::array<ReportMessage, BatchSize> reports;
+        ExecutionReport report;
+        while (!stop.stop_requested()) {
+            const std::uint64_t firstSequence = shard.inbox.nextSequence();
+            const std::size_t n = shard.inbox.popBatch(batch);
+            if (n == 0) {
+                shard.waiter.idle([&] { return stop.stop_requested() || shard.inbox.hasReady(); });
+                continue;
+            }
+            shard.waiter.busy();
+            for (std::size_t i = 0; i < n; ++i) {
+                const EngineCommand& command = batch[i];
+                const std::uint32_t slot = _routes[command.symbol].slot;
+                reports[i] = apply(*shard.books[slot], command, report);
+                reports[i].sequence = firstSequence + i;
+                if (_publishDepth) markChanged(shard, slot, firstSequence + i);
+            }
+            if (_publishDepth) publishDepth(shard);
+            if (_publishReports) publish(shard, std::span<const ReportMessage>(reports.data(), n), stop);
+            shard.processed.fetch_add(n, std::memory_order_release);
+        }
+    }
+
+    static void markChanged(Shard& shard, std::uint32_t slot, std::uint64_t sequence) {
+        shard.lastSequence[slot] = sequence;
+        if (shard.changed[slot]) return;
+        shard.changed[slot] = true;
+        shard.changedSlots.push_back(slot);
+    }
+
+    // One snapshot per book changed in the batch, however many commands it took
+    static void publishDepth(Shard& shard) {
+        Snapshot snapshot;
+        for (std::uint32_t slot : shard.changedSlots) {
+            shard.books[slot]->snapshotDepth(snapshot);
+            snapshot.sequence = shard.lastSequence[slot];
+            shard.snapshots[slot]->store(snapshot);
+            shard.changed[slot] = false;
+        }
+        shard.changedSlots.clear();
+    }
+
+    static void publish(Shard& shard, std::span<const ReportMessage> reports, const std::stop_token& stop) {
+        while (!reports.empty() && !stop.stop_requested()) {
+            const std::size_t pushed = shard.outbox.pushBatch(reports);
+            reports = reports.subspan(pushed);
+            if (!reports.empty()) std::this_thread::yield();
+        }
+    }
+
+    static ReportMessage apply(Book& book, const EngineCommand& command, ExecutionReport& report) {
+        ReportMessage message{command.tag, 0, command.orderId, command.symbol, command.kind};
+        switch (command.kind) {
+            case EngineCommand::Kind::SUBMIT:
+                book.submit(command.request, report);
+                message.orderId = report.orderId;
+                message.status = report.status;
+                message.cancelReason = report.cancelReason;
+                message.filledQuantity = report.filledQuantity;
+                message.restingQuantity = report.restingQuantity;
+                message.canceledQuantity = report.canceledQuantity;
+                message.notional = report.notional;
+                break;
+            case EngineCommand::Kind::CANCEL:
+                if (const Order* order = book.findOrder(command.orderId)) message.canceledQuantity = order->getRemainingQuantity();
+                if (book.cancel(command.orderId)) {
+                    message.status = OrderStatus::CANCELED;
+                    message.cancelReason = CancelReason::USER_REQUESTED;
+                } else {
+                    message.cancelReason = CancelReason::INVALID_ORDER;
+                }
+                break;
+            case EngineCommand::Kind::MODIFY:
+                report.reset();
+                if (!book.modify(command.orderId, command.quantity, command.price, &report)) {
+                    message.cancelReason = CancelReason::INVALID_ORDER;
+                } else if (report.orderId == 0) {
+                    // Amended in place, nothing was re-matched
+                    message.status = OrderStatus::RESTING;
+                    message.restingQuantity = command.quantity;
+                } else {
+                    message.status = report.status;
+                    message.cancelReason = report.cancelReason;
+                    message.filledQuantity = report.filledQuantity;
+                    message.restingQuantity = report.restingQuantity;
+                    message.canceledQuantity = report.canceledQuantity;
+                    message.notional = report.notional;
+                }
+                break;
+        }
+        return message;
+    }
+
+    std::unordered_map<std::string, SymbolId, SymbolHash, std::equal_to<>> _symbolIds;
+    std::vector<Route>                  _routes;        // by SymbolId, immutable after construction
+    bool                                _publishReports{false};
+    bool                                _publishDepth{false};
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+using Engine = BasicEngine<MapBackend>;
+using DenseEngine = BasicEngine<DenseBackend<>>;
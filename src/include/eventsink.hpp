@@ -0,0 +1,235 @@
+#pragma once
+#include <concepts>
+#include <cstdio>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "order.hpp"
+#include "execution.hpp"
+#include "ticksize.hpp"
+
+// An event sink is told about every outcome in the book as it happens.
+// It is a template parameter of BasicOrderbook, so calls are resolved at compile time and a
+// sink with empty callbacks (NullSink) costs nothing at all in the match loop.
+template <typename S>
+concept EventSink = requires(S sink, const Order& order, const OrderRequest& request,
+                             OrderID id, Side side, Price price, Quantity quantity, CancelReason reason) {
+    sink.onFill(order, order, price, quantity);     // taker, resting order, price, quantity
+    sink.onRest(order);                             // order (with its remaining quantity) now rests
+    sink.onModify(order);                           // resting order reduced in place, keeps priority
+    sink.onCancel(id, side, quantity, reason);      // quantity canceled, possibly after fills
+    sink.onReject(request, reason);                 // request never entered the book
+    sink.onOpenDay(price);                          // book cleared and reopened at today's price
+    sink.flush();                                   // end of a unit of work
+};
+
+// Discards everything
+struct NullSink {
+    void onFill(const Order&, const Order&, Price, Quantity) {}
+    void onRest(const Order&) {}
+    void onModify(const Order&) {}
+    void onCancel(OrderID, Side, Quantity, CancelReason) {}
+    void onReject(const OrderRequest&, CancelReason) {}
+    void onOpenDay(Price) {}
+    void flush() {}
+};
+
+// Human-readable lines on std::cout, for the interactive client
+class ConsoleSink {
+public:
+    explicit ConsoleSink(TickSize tickSize = TickSize{}) : _tickSize(tickSize) {}
+
+    void onFill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        std::cout << "  Fill: " << side(taker.getSide()) << " " << quantity << " @ $" << _tickSize.toDouble(price)
+                  << " | order " << taker.getOrderId() << " against order " << resting.getOrderId() << "\n";
+    }
+
+    void onRest(const Order& order) {
+        if (!_showRests) return;
+        std::cout << "  Rested: order " << order.getOrderId() << " | " << side(order.getSide()) << " "
+                  << order.getRemainingQuantity() << " @ $" << _tickSize.toDouble(order.getPrice()) << "\n";
+    }
+
+    void onModify(const Order& order) {
+        std::cout << "Order " << order.getOrderId() << " reduced to " << order.getRemainingQuantity()
+                  << " (keeps time priority).\n";
+    }
+
+    void onCancel(OrderID id, Side, Quantity quantity, CancelReason reason) {
+        switch (reason) {
+            case CancelReason::NO_LIQUIDITY:
+                std::cout << "No liquidity. Order canceled.\n";
+                break;
+            case CancelReason::FOK_NOT_FILLABLE:
+                std::cout << "FOK not fully fillable immediately. Canceled.\n";
+                break;
+            case CancelReason::IOC_REMAINDER:
+                std::cout << "Unfilled remainder of " << quantity << " canceled.\n";
+                break;
+            case CancelReason::BOOK_FULL:
+                std::cout << "Book full. Remainder canceled.\n";
+                break;
+            case CancelReason::USER_REQUESTED:
+                std::cout << "Order " << id << " canceled (" << quantity << " open).\n";
+                break;
+            case CancelReason::REPLACED:
+                std::cout << "Order " << id << " replaced.\n";
+                break;
+            case CancelReason::INVALID_ORDER:
+                std::cout << "Invalid TIF for this order type (per your rules). Canceled.\n";
+                break;
+            case CancelReason::NONE:
+                break;
+        }
+    }
+
+    void onReject(const OrderRequest&, CancelReason) {
+        std::cout << "Invalid order (price, quantity or TIF for this order type). Rejected.\n";
+    }
+
+    void onOpenDay(Price) {}        // populateOrderbook() prints today's price itself
+
+    void flush() { std::cout.flush(); }
+
+    // Off while loading a large opening book, which would print a line per order
+    void showRests(bool show) { _showRests = show; }
+
+private:
+    static const char* side(Side s) { return s == Side::BUY ? "BUY" : "SELL"; }
+
+    TickSize _tickSize;
+    bool     _showRests{true};
+};
+
+// Fixed-size binary event record, e.g. for journals and market data feeds
+struct EventRecord {
+    enum class Type : std::uint8_t { FILL, REST, MODIFY, CANCEL, REJECT, OPEN_DAY };
+
+    Type         type;
+    Side         side;
+    CancelReason reason;
+    OrderID      orderId;       // taker for FILL
+    OrderID      otherId;       // resting order for FILL
+    Price        price;         // today's price for OPEN_DAY
+    Quantity     quantity;      // remaining quantity for REST and MODIFY
+
+    // One record per sink callback
+    static EventRecord fill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        return {Type::FILL, taker.getSide(), CancelReason::NONE, taker.getOrderId(), resting.getOrderId(), price, quantity};
+    }
+
+    static EventRecord rest(const Order& order) {
+        return {Type::REST, order.getSide(), CancelReason::NONE, order.getOrderId(), 0, order.getPrice(), order.getRemainingQuantity()};
+    }
+
+    static EventRecord modify(const Order& order) {
+        return {Type::MODIFY, order.getSide(), CancelReason::NONE, order.getOrderId(), 0, order.getPrice(), order.getRemainingQuantity()};
+    }
+
+    static EventRecord cancel(OrderID id, Side side, Quantity quantity, CancelReason reason) {
+        return {Type::CANCEL, side, reason, id, 0, 0, quantity};
+    }
+
+    static EventRecord reject(const OrderRequest& request, CancelReason reason) {
+        return {Type::REJECT, request.side, reason, 0, 0, request.price, request.quantity};
+    }
+
+    static EventRecord openDay(Price todaysPrice) {
+        return {Type::OPEN_DAY, Side::BUY, CancelReason::NONE, 0, 0, todaysPrice, 0};
+    }
+};
+
+// Buffers EventRecords and writes them out in one fwrite per flush (or when the buffer fills).
+// With no file the records just accumulate in events() until flushed, for in-process consumers.
+class BinarySink {
+public:
+    explicit BinarySink(std::FILE* out = nullptr, std::size_t capacity = 4096) : _out(out) {
+        _events.reserve(capacity);
+    }
+
+    void onFill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        push(EventRecord::fill(taker, resting, price, quantity));
+    }
+
+    void onRest(const Order& order) { push(EventRecord::rest(order)); }
+
+    void onModify(const Order& order) { push(EventRecord::modify(order)); }
+
+    void onCancel(OrderID id, Side side, Quantity quantity, CancelReason reason) {
+        push(EventRecord::cancel(id, side, quantity, reason));
+    }
+
+    void onReject(const OrderRequest& request, CancelReason reason) { push(EventRecord::reject(request, reason)); }
+
+    void onOpenDay(Price todaysPrice) { push(EventRecord::openDay(todaysPrice)); }
+
+    void flush() {
+        if (_out == nullptr || _events.empty()) return;
+        std::fwrite(_events.data(), sizeof(EventRecord), _events.size(), _out);
+        _events.clear();
+    }
+
+    [[nodiscard]] const std::vector<EventRecord>& events() const { return _events; }
+
+private:
+    void push(const EventRecord& record) {
+        if (_out != nullptr && _events.size() == _events.capacity()) flush();
+        _events.push_back(record);
+    }
+
+    std::FILE*               _out;
+    std::vector<EventRecord> _events;
+};
+
+// Forwards every event to two sinks, first to `first`, e.g. a ConsoleSink and a JournalSink
+template <EventSink First, EventSink Second>
+class TeeSink {
+public:
+    explicit TeeSink(First first = First{}, Second second = Second{})
+            : _first(std::move(first)), _second(std::move(second)) {}
+
+    void onFill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        _first.onFill(taker, resting, price, quantity);
+        _second.onFill(taker, resting, price, quantity);
+    }
+
+    void onRest(const Order& order) {
+        _first.onRest(order);
+        _second.onRest(order);
+    }
+
+    void onModify(const Order& order) {
+        _first.onModify(order);
+        _second.onModify(order);
+    }
+
+    void onCancel(OrderID id, Side side, Quantity quantity, CancelReason reason) {
+        _first.onCancel(id, side, quantity, reason);
+        _second.onCancel(id, side, quantity, reason);
+    }
+
+    void onReject(const OrderRequest& request, CancelReason reason) {
+        _first.onReject(request, reason);
+        _second.onReject(request, reason);
+    }
+
+    void onOpenDay(Price todaysPrice) {
+        _first.onOpenDay(todaysPrice);
+        _second.onOpenDay(todaysPrice);
+    }
+
+    void flush() {
+        _first.flush();
+        _second.flush();
+    }
+
+    First&  first() { return _first; }
+    Second& second() { return _second; }
+
+private:
+    [[no_unique_address]] First  _first;
+    [[no_unique_address]] Second _second;
+};
+
+static_assert(EventSink<NullSink> && EventSink<ConsoleSink> && EventSink<BinarySink>);
+static_assert(EventSink<TeeSink<ConsoleSink, BinarySink>>);
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "order.hpp"
+
+// A new order as submitted by a client. Prices are in ticks of the book's TickSize.
+struct OrderRequest {
+    Side        side{};
+    OrderType   type{};
+    TimeInForce timeInForce{};
+    Price       price{};        // limit price, ignored for MARKET
+    Quantity    quantity{};
+};
+
+enum class OrderStatus {
+    FILLED,             // fully executed
+    PARTIALLY_FILLED,   // some executed, remainder resting on the book
+    RESTING,            // nothing executed, all of it resting on the book
+    CANCELED,           // remainder canceled, see CancelReason (may still have fills)
+    REJECTED            // never entered the book, see CancelReason
+};
+
+enum class CancelReason {
+    NONE,
+    INVALID_ORDER,      // bad price / quantity / TIF for the order type
+    NO_LIQUIDITY,       // nothing on the other side
+    FOK_NOT_FILLABLE,   // FILL_OR_KILL could not fill completely right now
+    IOC_REMAINDER,      // unfilled remainder of an order that doesn't rest
+    BOOK_FULL,          // remainder would rest but the order pool is exhausted
+    USER_REQUESTED,     // resting order canceled via cancel()
+    REPLACED            // resting order taken off the book by a price-changing modify()
+};
+
+// One execution against a resting order
+struct Fill {
+    OrderID  restingOrderId{};
+    Price    price{};
+    Quantity quantity{};
+};
+
+// Everything that happened to one submitted order
+struct ExecutionReport {
+    OrderID           orderId{0};
+    OrderStatus       status{OrderStatus::REJECTED};
+    CancelReason      cancelReason{CancelReason::NONE};
+    std::vector<Fill> fills;
+    Quantity          filledQuantity{0};
+    Quantity          restingQuantity{0};
+    Quantity          canceledQuantity{0};
+    Price             notional{0};          // ticks x shares, exact
+
+    // Volume-weighted average fill price in ticks, 0 if nothing filled
+    [[nodiscard]] double vwap() const {
+        return filledQuantity ? static_cast<double>(notional) / static_cast<double>(filledQuantity) : 0.0;
+    }
+
+    // Back to an empty report, keeping the fill storage so reusing a report doesn't allocate
+    void reset() {
+        orderId = 0;
+        status = OrderStatus::REJECTED;
+        cancelReason = CancelReason::NONE;
+        fills.clear();
+        filledQuantity = restingQuantity = canceledQuantity = 0;
+        notional = 0;
+    }
+};
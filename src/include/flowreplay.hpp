@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "execution.hpp"
+#include "latencyrecorder.hpp"
+#include "mappedfile.hpp"
+#include "waitstrategy.hpp"
+
+// One recorded command of order flow
+struct CaptureRecord {
+    enum class Kind : std::uint8_t { ADD, MARKET, CANCEL, MODIFY };
+
+    std::uint64_t timestamp;        // ns, any epoch: only the gaps between records matter
+    std::uint64_t ref;              // CANCEL / MODIFY: index in the capture of the ADD it targets
+    Price         price;            // ADD / MODIFY: limit price
+    Quantity      quantity;         // ADD / MARKET / MODIFY: (new) open quantity
+    Kind          kind;
+    Side          side;             // ADD / MARKET
+    TimeInForce   timeInForce;      // ADD: GOOD_TILL_CANCEL or FILL_OR_KILL; MARKET: IMMEDIATE_OR_CANCEL or FILL_OR_KILL
+
+    static CaptureRecord add(std::uint64_t timestamp, const OrderRequest& request) {
+        const Kind kind = request.type == OrderType::MARKET ? Kind::MARKET : Kind::ADD;
+        return {timestamp, 0, request.price, request.quantity, kind, request.side, request.timeInForce};
+    }
+
+    static CaptureRecord cancel(std::uint64_t timestamp, std::uint64_t ref) {
+        return {timestamp, ref, 0, 0, Kind::CANCEL, Side::BUY, TimeInForce::GOOD_TILL_CANCEL};
+    }
+
+    static CaptureRecord modify(std::uint64_t timestamp, std::uint64_t ref, Price price, Quantity quantity) {
+        return {timestamp, ref, price, quantity, Kind::MODIFY, Side::BUY, TimeInForce::GOOD_TILL_CANCEL};
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<CaptureRecord>);
+
+// Capture file: a fixed header followed by raw CaptureRecords in timestamp order
+struct CaptureHeader {
+    char          magic[8]{'M', 'T', 'O', 'F', 'L', 'O', 'W', '1'};
+    std::uint32_t recordSize{sizeof(CaptureRecord)};
+    std::uint64_t recordCount{0};
+};
+
+inline void writeCapture(const std::string& path, std::span<const CaptureRecord> records) {
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) throw std::system_error(errno, std::generic_category(), "Cannot create " + path);
+    CaptureHeader header;
+    header.recordCount = records.size();
+    const bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                         (records.empty() || std::fwrite(records.data(), sizeof(CaptureRecord), records.size(), out) == records.size());
+    const int error = errno;
+    if (std::fclose(out) != 0 || !written) throw std::system_error(error, std::generic_category(), "Cannot write capture " + path);
+}
+
+// A capture file mapped read-only: the records are read straight out of the mapping, after a
+// check when it is opened that each one is a kind replayCapture knows, with a known side and
+// time in force where it has them, and that timestamps never go back
+class FlowCapture {
+public:
+    explicit FlowCapture(const std::string& path) : _file(path) {
+        CaptureHeader header;
+        if (_file.size() < sizeof(header)) throw std::invalid_argument("Not a capture (too short): " + path);
+        std::memcpy(&header, _file.bytes().data(), sizeof(header));
+        if (std::memcmp(header.magic, CaptureHeader{}.magic, sizeof(header.magic)) != 0 ||
+            header.recordSize != sizeof(CaptureRecord) ||
+            header.recordCount > (_file.size() - sizeof(CaptureHeader)) / sizeof(CaptureRecord)) {
+            throw std::invalid_argument("Not a complete capture: " + path);
+        }
+        _count = header.recordCount;
+        const std::span<const CaptureRecord> recorded = records();
+        for (std::size_t i = 0; i < recorded.size(); ++i) {
+            const CaptureRecord& record = recorded[i];
+            auto fail = [&](const char* what) {
+                throw std::invalid_argument("Capture record " + std::to_string(i) + " " + what + ": " + path);
+            };
+            if (record.kind > CaptureRecord::Kind::MODIFY) fail("has an unknown kind");
+            if (i > 0 && record.timestamp < recorded[i - 1].timestamp) fail("is earlier than the one before");
+            if (record.kind == CaptureRecord::Kind::ADD || record.kind == CaptureRecord::Kind::MARKET) {
+                if (record.side != Side::BUY && record.side != Side::SELL) fail("has an unknown side");
+                if (record.timeInForce != TimeInForce::FILL_OR_KILL && record.timeInForce != TimeInForce::IMMEDIATE_OR_CANCEL &&
+                    record.timeInForce != TimeInForce::GOOD_TILL_CANCEL) {
+                    fail("has an unknown time in force");
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] std::span<const CaptureRecord> records() const {
+        return {reinterpret_cast<const CaptureRecord*>(_file.bytes().data() + sizeof(CaptureHeader)), _count};
+    }
+
+    [[nodiscard]] std::size_t size() const { return _count; }
+
+private:
+    MappedFile  _file;
+    std::size_t _count{0};
+};
+
+// How fast a replay feeds the book
+enum class ReplayPacing {
+    AS_FAST_AS_POSSIBLE,    // next command as soon as the last one returns
+    REAL_TIME,              // keep the recorded gaps between commands
+    SCALED                  // recorded gaps divided by ReplayConfig::speed (N x real time)
+};
+
+struct ReplayConfig {
+    ReplayPacing pacing = ReplayPacing::AS_FAST_AS_POSSIBLE;
+    double       speed = 1.0;       // SCALED only
+};
+
+struct ReplayStats {
+    std::size_t                      messages{0};
+    std::size_t                      unmatched{0};     // cancels / modifies of orders no longer resting
+    LatencyRecorder::Clock::duration wall{};
+    LatencyRecorder::Clock::duration maxLag{};        // paced: furthest a command started behind schedule
+
+    [[nodiscard]] double messagesPerSecond() const {
+        if (wall.count() == 0) return 0.0;
+        return static_cast<double>(messages) / std::chrono::duration<double>(wall).count();
+    }
+};
+
+// Feed a capture through `book`, recording each command's latency (the book call alone, not
+// the pacing) into `latency`, which should be sized for capture.size() samples.
+// The only allocations are made before the first command: the capture-index -> book-id table
+// and the reused execution report. Paced replays sleep while well ahead of schedule and spin
+// for the last stretch, so a command starts within a few hundred ns of its slot.
+template <typename Book>
+ReplayStats replayCapture(Book& book, const FlowCapture& capture, ReplayConfig config, LatencyRecorder& latency) {
+    using Clock = LatencyRecorder::Clock;
+    if (config.pacing == ReplayPacing::SCALED && !(config.speed > 0)) {
+        throw std::invalid_argument("Replay speed must be positive");
+    }
+    const double speed = config.pacing == ReplayPacing::SCALED ? config.speed : 1.0;
+    const std::span<const CaptureRecord> records = capture.records();
+
+    std::vector<OrderID> ids(records.size(), 0);        // book id of the ADD at each index
+    ExecutionReport report;
+    report.fills.reserve(256);
+    ReplayStats stats;
+
+    const std::uint64_t firstTimestamp = records.empty() ? 0 : records.front().timestamp;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const CaptureRecord& record = records[i];
+        if (config.pacing != ReplayPacing::AS_FAST_AS_POSSIBLE) {
+            const auto offset = std::chrono::nanoseconds(
+                    static_cast<std::int64_t>(static_cast<double>(record.timestamp - firstTimestamp) / speed));
+            const auto due = start + std::chrono::duration_cast<Clock::duration>(offset);
+            for (auto now = Clock::now(); now < due; now = Clock::now()) {
+                if (due - now > std::chrono::microseconds(200)) std::this_thread::sleep_for(due - now - std::chrono::microseconds(100));
+                else                                            cpuRelax();
+            }
+            stats.maxLag = std::max(stats.maxLag, Clock::now() - due);
+        }
+
+        const bool known = record.ref < i;
+        const auto t0 = Clock::now();
+        switch (record.kind) {
+            case CaptureRecord::Kind::ADD:
+                book.submit({record.side, OrderType::LIMIT, record.timeInForce, record.price, record.quantity}, report);
+                ids[i] = report.orderId;
+                break;
+            case CaptureRecord::Kind::MARKET:
+                book.submit({record.side, OrderType::MARKET, record.timeInForce, 0, record.quantity}, report);
+                break;
+            case CaptureRecord::Kind::CANCEL:
+                if (!known || !book.cancel(ids[record.ref])) ++stats.unmatched;
+                break;
+            case CaptureRecord::Kind::MODIFY:
+                if (!known || !book.modify(ids[record.ref], record.quantity, record.price, &report)) ++stats.unmatched;
+                break;
+        }
+        latency.record(Clock::now() - t0);
+    }
+    stats.wall = Clock::now() - start;
+    stats.messages = records.size();
+    return stats;
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "eventsink.hpp"
+
+// When journaled records are forced to disk. Records are in the page cache, and so survive
+// a crash of the process, as soon as they are appended; this only matters for the machine.
+enum class JournalFlush {
+    PER_EVENT,      // msync each record before the book goes on (slowest, nothing is ever lost)
+    BATCHED,        // msync once per unit of work: a submit / cancel / modify, or a whole submitBatch
+    ASYNC           // start writeback once per unit of work and don't wait for it (sync_file_range
+                    // on Linux, where msync(MS_ASYNC) does nothing; msync(MS_ASYNC) elsewhere)
+};
+
+struct JournalConfig {
+    JournalFlush flush = JournalFlush::BATCHED;
+
+    // Records the file is pre-sized for; a full journal doubles the file and maps it again
+    std::size_t  capacity = 1 << 20;
+};
+
+// One journaled event. 64 bytes and 64-byte aligned in the file, so a record never straddles
+// a page: it reaches the disk whole or not at all.
+struct alignas(64) JournalRecord {
+    std::uint64_t sequence;     // 1, 2, 3, ...: 0 (never written) or out of order ends the journal
+    EventRecord   event;
+};
+
+static_assert(sizeof(JournalRecord) == 64);
+
+// Start of a journal file; the records follow it
+struct alignas(64) JournalHeader {
+    char          magic[8]{'M', 'T', 'O', 'J', 'R', 'N', 'L', '2'};
+    std::uint32_t recordSize{sizeof(JournalRecord)};
+    std::uint64_t firstSequence{1};     // of the first record in the file
+};
+
+// fsync the directory holding `path`, which makes a rename to `path` durable. False, with
+// errno set, if it couldn't be done.
+inline bool syncParentDirectory(const std::string& path) {
+    const std::size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool synced = ::fsync(fd) == 0;
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    return synced;
+}
+
+// Append-only binary write-ahead log of a book's outcomes in a pre-sized memory-mapped file.
+// Appending is a copy into the mapping, with no system call unless the flush policy asks for
+// one. Sequence numbers run on across truncations, so a snapshot can name the last record it
+// covers. Opening an existing file takes every record up to the first missing sequence
+// number, so a torn tail from a crash is dropped and overwritten by the next append; a
+// partial record at the very end of the file is cut off.
+// Not thread-safe: one journal per book, used from the book's thread.
+class Journal {
+public:
+    explicit Journal(std::string path, JournalConfig config = JournalConfig{}) : _path(std::move(path)), _config(config) {
+        if (_config.capacity == 0) _config.capacity = 1;
+        _fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (_fd < 0) throw std::system_error(errno, std::generic_category(), "Cannot open journal " + _path);
+        try {
+            struct stat st{};
+            if (::fstat(_fd, &st) != 0) throw std::system_error(errno, std::generic_category(), "Cannot stat journal");
+            const auto existing = static_cast<std::size_t>(st.st_size);
+            if (existing != 0 && existing < sizeof(JournalHeader)) throw std::invalid_argument("Not a journal (bad size): " + _path);
+            const std::size_t records = existing ? (existing - sizeof(JournalHeader)) / sizeof(JournalRecord) : 0;
+            // A file appended with write() (an AsyncWriterSink's) can end in part of a record
+            // from a crash: cut it off, so that growing the file below can't bring any of it back
+            if (existing != 0 && existing != bytesFor(records) && ::ftruncate(_fd, static_cast<off_t>(bytesFor(records))) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Cannot cut torn record off journal");
+            }
+            _capacity = std::max(records, _config.capacity);
+            _base = mapFile(_fd, _capacity);
+
+            if (existing == 0) {
+                *header() = JournalHeader{};
+            } else if (std::memcmp(header()->magic, JournalHeader{}.magic, sizeof(JournalHeader::magic)) != 0 ||
+                       header()->recordSize != sizeof(JournalRecord)) {
+                throw std::invalid_argument("Not a journal (bad header): " + _path);
+            }
+            _firstSequence = header()->firstSequence;
+            while (_size < _capacity && slots()[_size].sequence == _firstSequence + _size) ++_size;
+            // Records past a gap were written after ones that never made it; they must not be
+            // taken for valid ones once appends reach them
+            for (std::size_t i = _size; i < records; ++i) {
+                if (slots()[i].sequence != 0) slots()[i].sequence = 0;
+            }
+            syncRange(0, records, MS_SYNC);
+            _synced = _size;
+        } catch (...) {
+            if (_base != nullptr) ::munmap(_base, bytesFor(_capacity));
+            ::close(_fd);
+            throw;
+        }
+    }
+
+    // Everything appended is forced to disk before the file is closed
+    ~Journal() {
+        ::msync(_base, bytesFor(_size), MS_SYNC);
+        ::munmap(_base, bytesFor(_capacity));
+        ::close(_fd);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void append(const EventRecord& event) {
+        if (_size == _capacity) grow();
+        JournalRecord& record = slots()[_size];
+        record.event = event;
+        record.sequence = _firstSequence + _size;
+        ++_size;
+        if (_config.flush == JournalFlush::PER_EVENT) syncRange(_size - 1, _size, MS_SYNC);
+    }
+
+    // End of a unit of work: applies the flush policy to what it appended
+    void commit() {
+        switch (_config.flush) {
+            case JournalFlush::PER_EVENT: break;
+            case JournalFlush::BATCHED:   syncRange(_synced, _size, MS_SYNC); break;
+            case JournalFlush::ASYNC:     startWriteback(_synced, _size); break;
+        }
+        _synced = _size;
+    }
+
+    // Force everything appended so far to disk, whatever the policy
+    void sync() {
+        syncRange(0, _size, MS_SYNC);
+        _synced = _size;
+    }
+
+    // Drop every record up to and including sequence `upTo`, e.g. once a snapshot covers them.
+    // The records after it go into a new file that then replaces this one with a rename, so a
+    // crash at any point leaves either the old journal or the new one, each complete. Costs a
+    // copy of the records kept, which are those appended since the snapshot was taken.
+    void truncate(std::uint64_t upTo) {
+        if (upTo < _firstSequence || _size == 0) return;
+        const std::size_t dropped = std::min<std::size_t>(upTo - _firstSequence + 1, _size);
+        const std::size_t kept = _size - dropped;
+        const std::size_t capacity = std::max(kept, _config.capacity);
+        const std::string tempPath = _path + ".tmp";
+
+        const int fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "Cannot create " + tempPath);
+        std::byte* base = nullptr;
+        try {
+            base = mapFile(fd, capacity);
+            JournalHeader& fresh = *reinterpret_cast<JournalHeader*>(base);
+            fresh = JournalHeader{};
+            fresh.firstSequence = _firstSequence + dropped;
+            std::memcpy(base + sizeof(JournalHeader), slots() + dropped, kept * sizeof(JournalRecord));
+            if (::msync(base, bytesFor(kept), MS_SYNC) != 0) throw std::system_error(errno, std::generic_category(), "Cannot sync journal");
+            if (::rename(tempPath.c_str(), _path.c_str()) != 0) throw std::system_error(errno, std::generic_category(), "Cannot replace journal");
+        } catch (...) {
+            if (base != nullptr) ::munmap(base, bytesFor(capacity));
+            ::close(fd);
+            ::unlink(tempPath.c_str());
+            throw;
+        }
+        syncParentDirectory(_path);
+
+        ::munmap(_base, bytesFor(_capacity));
+        ::close(_fd);
+        _fd = fd;
+        _base = base;
+        _capacity = capacity;
+        _firstSequence += dropped;
+        _size = kept;
+        _synced = kept;
+    }
+
+    [[nodiscard]] std::size_t size() const { return _size; }
+    [[nodiscard]] std::size_t capacity() const { return _capacity; }
+    [[nodiscard]] JournalFlush flushPolicy() const { return _config.flush; }
+    [[nodiscard]] const std::string& path() const { return _path; }
+
+    // Sequence of the oldest record held; the next one appended gets this if the journal is empty
+    [[nodiscard]] std::uint64_t firstSequence() const { return _firstSequence; }
+
+    // Sequence of the newest record, or firstSequence() - 1 if there is none
+    [[nodiscard]] std::uint64_t lastSequence() const { return _firstSequence + _size - 1; }
+
+    [[nodiscard]] const EventRecord& operator[](std::size_t i) const { return slots()[i].event; }
+
+    // f(sequence, event) for every record, oldest first
+    template <typename F>
+    void forEach(F&& f) const {
+        for (std::size_t i = 0; i < _size; ++i) f(_firstSequence + i, slots()[i].event);
+    }
+
+private:
+    JournalHeader* header() const { return reinterpret_cast<JournalHeader*>(_base); }
+    JournalRecord* slots() const { return reinterpret_cast<JournalRecord*>(_base + sizeof(JournalHeader)); }
+
+    static std::size_t bytesFor(std::size_t records) { return sizeof(JournalHeader) + records * sizeof(JournalRecord); }
+
+    // Size the file for `records` and map all of it
+    static std::byte* mapFile(int fd, std::size_t records) {
+        const std::size_t bytes = bytesFor(records);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) throw std::system_error(errno, std::generic_category(), "Cannot size journal");
+        void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "Cannot map journal");
+        return static_cast<std::byte*>(base);
+    }
+
+    // The old mapping stays valid until the bigger one is in place
+    void grow() {
+        std::byte* base = mapFile(_fd, _capacity * 2);
+        ::munmap(_base, bytesFor(_capacity));
+        _base = base;
+        _capacity *= 2;
+    }
+
+    // msync records [first, last); the range is widened to whole pages as msync requires
+    void syncRange(std::size_t first, std::size_t last, int flags) {
+        if (first >= last) return;
+        static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = (first == 0 ? 0 : bytesFor(first)) / page * page;
+        const std::size_t end = bytesFor(last);
+        if (::msync(_base + begin, end - begin, flags) != 0) throw std::system_error(errno, std::generic_category(), "Cannot sync journal");
+    }
+
+    // Start writing records [first, last) back without waiting for the disk. Pages dirtied
+    // through the mapping are the file's page cache pages, so sync_file_range reaches them.
+    void startWriteback(std::size_t first, std::size_t last) {
+        if (first >= last) return;
+#if defined(__linux__)
+        static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = (first == 0 ? 0 : bytesFor(first)) / page * page;
+        const std::size_t end = bytesFor(last);
+        if (::sync_file_range(_fd, static_cast<off_t>(begin), static_cast<off_t>(end - begin), SYNC_FILE_RANGE_WRITE) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot start journal writeback");
+        }
+#else
+        syncRange(first, last, MS_ASYNC);
+#endif
+    }
+
+    std::string   _path;
+    JournalConfig _config;
+    int           _fd{-1};
+    std::byte*    _base{nullptr};
+    std::size_t   _capacity{0};         // records the mapping holds
+    std::size_t   _size{0};             // records held
+    std::size_t   _synced{0};           // records covered by the last commit()
+    std::uint64_t _firstSequence{1};
+};
+
+// Ready the journal file at `path` (created if missing) for an appender that writes records
+// itself, such as an AsyncWriterSink: the file is cut back to its last complete record, dropping
+// a torn tail and the space Journal pre-sizes files with. Returns the sequence number the next
+// record must carry.
+inline std::uint64_t trimJournal(const std::string& path) {
+    std::uint64_t next;
+    std::size_t bytes;
+    {
+        const Journal journal(path, JournalConfig{JournalFlush::BATCHED, 1});
+        next = journal.lastSequence() + 1;
+        bytes = sizeof(JournalHeader) + journal.size() * sizeof(JournalRecord);
+    }
+    if (::truncate(path.c_str(), static_cast<off_t>(bytes)) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot trim journal " + path);
+    }
+    return next;
+}
+
+// Journals every outcome of a book. With no journal it does nothing, so a book type can
+// carry one whether or not journaling is switched on.
+class JournalSink {
+public:
+    explicit JournalSink(Journal* journal = nullptr) : _journal(journal) {}
+
+    void onFill(const Order& taker, const Order& resting, Price price, Quantity quantity) {
+        append(EventRecord::fill(taker, resting, price, quantity));
+    }
+
+    void onRest(const Order& order) { append(EventRecord::rest(order)); }
+
+    void onModify(const Order& order) { append(EventRecord::modify(order)); }
+
+    void onCancel(OrderID id, Side side, Quantity quantity, CancelReason reason) {
+        append(EventRecord::cancel(id, side, quantity, reason));
+    }
+
+    void onReject(const OrderRequest& request, CancelReason reason) { append(EventRecord::reject(request, reason)); }
+
+    void onOpenDay(Price todaysPrice) { append(EventRecord::openDay(todaysPrice)); }
+
+    void flush() {
+        if (_journal != nullptr) _journal->commit();
+    }
+
+    [[nodiscard]] Journal* journal() const { return _journal; }
+
+private:
+    void append(const EventRecord& record) {
+        if (_journal != nullptr) _journal->append(record);
+    }
+
+    Journal* _journal;
+};
+
+static_assert(EventSink<JournalSink>);
+
+// Startup: rebuild `book` from the records in `journal` after sequence `after` (everything by
+// default; a snapshot's journalSequence when the book was restored from one, see
+// booksnapshot.hpp). The book must be set up like the one that wrote the journal (same
+// BookConfig, and recentered the same way if the records don't start with a day).
+// Returns the number of records replayed.
+template <typename Book>
+std::size_t replayJournal(const Journal& journal, Book& book, std::uint64_t after = 0) {
+    std::size_t replayed = 0;
+    journal.forEach([&](std::uint64_t sequence, const EventRecord& event) {
+        if (sequence <= after) return;
+        book.replay(event);
+        ++replayed;
+    });
+    return replayed;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+// Collects per-operation latencies into preallocated storage and reports percentiles.
+// Recording is a push_back into reserved space, so it doesn't disturb what it measures.
+class LatencyRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LatencyRecorder(std::size_t expectedSamples = 1 << 20) { _samples.reserve(expectedSamples); }
+
+    void record(Clock::duration elapsed) {
+        _samples.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        _sorted = false;
+    }
+
+    void clear() {
+        _samples.clear();
+        _sorted = false;
+    }
+
+    // Add another recorder's samples, e.g. one per thread after the threads are done
+    void merge(const LatencyRecorder& other) {
+        _samples.insert(_samples.end(), other._samples.begin(), other._samples.end());
+        _sorted = false;
+    }
+
+    [[nodiscard]] std::size_t count() const { return _samples.size(); }
+
+    // p in [0, 100]; sorts the samples on first use after recording
+    [[nodiscard]] std::uint64_t percentile(double p) {
+        if (_samples.empty()) return 0;
+        if (!_sorted) {
+            std::sort(_samples.begin(), _samples.end());
+            _sorted = true;
+        }
+        const auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(_samples.size() - 1));
+        return _samples[rank];
+    }
+
+    // One line: count, p50 / p99 / p99.9 / max in ns, and throughput over `wall`
+    void print(std::string_view label, Clock::duration wall) {
+        const double seconds = std::chrono::duration<double>(wall).count();
+        std::cout << label << ": " << count() << " ops"
+                  << " | " << static_cast<double>(count()) / seconds / 1e6 << " M ops/s"
+                  << " | p50 " << percentile(50) << "ns"
+                  << " p99 " << percentile(99) << "ns"
+                  << " p99.9 " << percentile(99.9) << "ns"
+                  << " max " << percentile(100) << "ns\n";
+    }
+
+private:
+    std::vector<std::uint64_t> _samples;
+    bool                       _sorted{false};
+};
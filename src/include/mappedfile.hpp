@@ -0,0 +1,57 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A whole file mapped read-only, for readers that go through it front to back. The bytes are
+// read straight out of the page cache: opening one costs no copy and no allocation however
+// large the file is. An empty file maps to an empty span.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "Cannot stat " + path);
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        if (_size != 0) {
+            void* base = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            const int error = errno;
+            ::close(fd);
+            if (base == MAP_FAILED) throw std::system_error(error, std::generic_category(), "Cannot map " + path);
+            _base = static_cast<const std::byte*>(base);
+            ::madvise(base, _size, MADV_SEQUENTIAL);        // read ahead, drop pages behind
+        } else {
+            ::close(fd);
+        }
+    }
+
+    ~MappedFile() {
+        if (_base != nullptr) ::munmap(const_cast<std::byte*>(_base), _size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<const std::byte> bytes() const { return {_base, _size}; }
+
+    // The contents as text, e.g. for parsing with std::from_chars
+    [[nodiscard]] std::string_view text() const { return {reinterpret_cast<const char*>(_base), _size}; }
+
+    [[nodiscard]] std::size_t size() const { return _size; }
+
+private:
+    const std::byte* _base{nullptr};
+    std::size_t      _size{0};
+};
@@ -1,3 +1,6 @@
+#pragma once
+#include <array>
+#include <iostream>
 #include "order.hpp"
 
 struct MatchingPolicy {
@@ -88,4 +91,29 @@ constexpr MatchingPolicy policyFor(OrderType order_type, TimeInForce time_in_for
             /*allow_partial_immediate_execution=*/true,
             /*rest_unfilled_remainder_on_book=*/false
     };
+}
+
+// Every (OrderType, TimeInForce) policy, computed once at compile time so the match path
+// does a table load instead of walking the switch above for each order.
+inline constexpr std::size_t kOrderTypes   = 2;
+inline constexpr std::size_t kTimesInForce = 3;
+
+inline constexpr std::array<MatchingPolicy, kOrderTypes * kTimesInForce> kPolicyTable = [] {
+    std::array<MatchingPolicy, kOrderTypes * kTimesInForce> table{};
+    for (std::size_t ot = 0; ot < kOrderTypes; ++ot)
+        for (std::size_t tif = 0; tif < kTimesInForce; ++tif)
+            table[ot * kTimesInForce + tif] = policyFor(static_cast<OrderType>(ot), static_cast<TimeInForce>(tif));
+    return table;
+}();
+
+constexpr const MatchingPolicy& cachedPolicyFor(OrderType order_type, TimeInForce time_in_force) {
+    return kPolicyTable[static_cast<std::size_t>(order_type) * kTimesInForce + static_cast<std::size_t>(time_in_force)];
+}
+
+// A resting price is acceptable to a taker if it is at or better than the taker's limit.
+// Prices are integer ticks, so this is an exact compare.
+constexpr bool price_is_acceptable(OrderType order_type, Side taker_side, Price limit, Price resting) {
+    if (order_type == OrderType::MARKET) return true;
+    if (taker_side == Side::BUY) return resting <= limit;
+    else                         return resting >= limit;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include "cacheline.hpp"
+
+// Bounded multi-producer / single-consumer ring of trivially copyable items.
+// Producers claim a position with a CAS on the shared head; that position is the item's
+// arrival sequence, a single total order over everything pushed by every producer. Each slot
+// carries its own sequence number that says whose turn it is (Vyukov's bounded queue), so a
+// producer writes its slot without any lock and the consumer sees items strictly in claim order.
+// Storage is allocated once in the constructor.
+template <typename T, std::size_t Capacity>
+class MpscRing {
+    static_assert(std::has_single_bit(Capacity), "MpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "MpscRing items are copied as plain bytes");
+
+public:
+    MpscRing() : _slots(std::make_unique<Slot[]>(Capacity)) {
+        for (std::size_t i = 0; i < Capacity; ++i) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread. The item's arrival sequence, or nullopt if the ring is full.
+    std::optional<std::uint64_t> tryPush(const T& item) {
+        std::uint64_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[pos & Mask];
+            const std::uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::int64_t>(seq - pos);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return std::nullopt;            // the consumer hasn't freed this slot yet
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        Slot& slot = _slots[pos & Mask];
+        slot.item = item;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return pos;
+    }
+
+    // Consumer only. Pops up to out.size() items that are fully written, in arrival order;
+    // the first one has arrival sequence nextSequence() as read before the call.
+    std::size_t popBatch(std::span<T> out) {
+        std::size_t n = 0;
+        while (n < out.size()) {
+            Slot& slot = _slots[(_tail + n) & Mask];
+            if (slot.sequence.load(std::memory_order_acquire) != _tail + n + 1) break;
+            out[n] = slot.item;
+            ++n;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            _slots[(_tail + i) & Mask].sequence.store(_tail + i + Capacity, std::memory_order_release);
+        }
+        _tail += n;
+        return n;
+    }
+
+    bool tryPop(T& item) { return popBatch(std::span<T>(&item, 1)) == 1; }
+
+    // Consumer only: whether popBatch would return something now
+    [[nodiscard]] bool hasReady() const {
+        return _slots[_tail & Mask].sequence.load(std::memory_order_acquire) == _tail + 1;
+    }
+
+    // Consumer only: arrival sequence of the next item to pop
+    [[nodiscard]] std::uint64_t nextSequence() const { return _tail; }
+
+    // Any thread: how many positions producers have claimed so far
+    [[nodiscard]] std::uint64_t claimed() const { return _head.load(std::memory_order_acquire); }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::uint64_t Mask = Capacity - 1;
+
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        T                          item{};
+    };
+
+    std::unique_ptr<Slot[]>                           _slots;       // read by everyone, never written
+    alignas(CacheLineSize) std::atomic<std::uint64_t> _head{0};     // next position to claim
+    alignas(CacheLineSize) std::uint64_t              _tail{0};     // next position to pop
+};
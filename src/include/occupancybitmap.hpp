@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Three-level occupancy bitmap over `Bits` slots (up to 64^3 = 262144).
+// Every summary bit says "the 64 bits below me are not all zero", so finding the
+// lowest/highest set slot, or the next one above/below a slot, is a handful of
+// countr_zero / countl_zero (tzcnt / lzcnt) instructions regardless of how sparse it is.
+template <std::size_t Bits>
+class OccupancyBitmap {
+    static_assert(Bits >= 64 && Bits % 64 == 0 && Bits <= 64 * 64 * 64,
+                  "OccupancyBitmap size must be a multiple of 64 and at most 262144");
+
+    static constexpr std::size_t LeafWords = Bits / 64;
+    static constexpr std::size_t MidWords  = (LeafWords + 63) / 64;
+
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    [[nodiscard]] bool test(std::size_t i) const { return (_leaf[i >> 6] >> (i & 63)) & 1u; }
+
+    [[nodiscard]] bool none() const { return _top == 0; }
+
+    void set(std::size_t i) {
+        _leaf[i >> 6] |= bit(i & 63);
+        _mid[i >> 12] |= bit((i >> 6) & 63);
+        _top          |= bit(i >> 12);
+    }
+
+    void reset(std::size_t i) {
+        _leaf[i >> 6] &= ~bit(i & 63);
+        if (_leaf[i >> 6] != 0) return;
+        _mid[i >> 12] &= ~bit((i >> 6) & 63);
+        if (_mid[i >> 12] != 0) return;
+        _top &= ~bit(i >> 12);
+    }
+
+    void clear() {
+        _leaf.fill(0);
+        _mid.fill(0);
+        _top = 0;
+    }
+
+    // Lowest set slot, or npos
+    [[nodiscard]] std::size_t first() const {
+        if (_top == 0) return npos;
+        const std::size_t m = lowest(_top);
+        const std::size_t w = (m << 6) | lowest(_mid[m]);
+        return (w << 6) | lowest(_leaf[w]);
+    }
+
+    // Highest set slot, or npos
+    [[nodiscard]] std::size_t last() const {
+        if (_top == 0) return npos;
+        const std::size_t m = highest(_top);
+        const std::size_t w = (m << 6) | highest(_mid[m]);
+        return (w << 6) | highest(_leaf[w]);
+    }
+
+    // Lowest set slot strictly above i, or npos
+    [[nodiscard]] std::size_t nextAbove(std::size_t i) const {
+        // same leaf word
+        std::size_t w = i >> 6;
+        if (std::uint64_t bits = _leaf[w] & above(i & 63)) return (w << 6) | lowest(bits);
+
+        // another leaf word under the same mid word
+        std::size_t m = w >> 6;
+        if (std::uint64_t words = _mid[m] & above(w & 63)) {
+            w = (m << 6) | lowest(words);
+            return (w << 6) | lowest(_leaf[w]);
+        }
+
+        // another mid word
+        std::uint64_t mids = _top & above(m);
+        if (mids == 0) return npos;
+        m = lowest(mids);
+        w = (m << 6) | lowest(_mid[m]);
+        return (w << 6) | lowest(_leaf[w]);
+    }
+
+    // Highest set slot strictly below i, or npos
+    [[nodiscard]] std::size_t nextBelow(std::size_t i) const {
+        std::size_t w = i >> 6;
+        if (std::uint64_t bits = _leaf[w] & below(i & 63)) return (w << 6) | highest(bits);
+
+        std::size_t m = w >> 6;
+        if (std::uint64_t words = _mid[m] & below(w & 63)) {
+            w = (m << 6) | highest(words);
+            return (w << 6) | highest(_leaf[w]);
+        }
+
+        std::uint64_t mids = _top & below(m);
+        if (mids == 0) return npos;
+        m = highest(mids);
+        w = (m << 6) | highest(_mid[m]);
+        return (w << 6) | highest(_leaf[w]);
+    }
+
+private:
+    static constexpr std::uint64_t bit(std::size_t i) { return std::uint64_t{1} << i; }
+
+    // bits strictly above / below position i within a word
+    static constexpr std::uint64_t above(std::size_t i) { return i == 63 ? 0 : ~std::uint64_t{0} << (i + 1); }
+    static constexpr std::uint64_t below(std::size_t i) { return bit(i) - 1; }
+
+    static std::size_t lowest(std::uint64_t x)  { return static_cast<std::size_t>(std::countr_zero(x)); }
+    static std::size_t highest(std::uint64_t x) { return static_cast<std::size_t>(63 - std::countl_zero(x)); }
+
+    std::array<std::uint64_t, LeafWords> _leaf{};
+    std::array<std::uint64_t, MidWords>  _mid{};
+    std::uint64_t                        _top{0};
+};
@@ -5,15 +5,16 @@
 #include "type.hpp"
 
 using OrderID  = std::uint64_t;
-using Price    = std::double_t;
+using Price    = std::int64_t;   // integer ticks, see TickSize
 using Quantity = std::int64_t;
 
 class Order {
 public:
-    static Order create(Side side, OrderType type, TimeInForce timeInForce, Price price, Quantity qty) {
-        Order o(side, type, timeInForce, price, qty);  // ctor runs
+    // `orderId` comes from the book's OrderIdGenerator (see orderid.hpp)
+    static Order create(OrderID orderId, Side side, OrderType type, TimeInForce timeInForce, Price price, Quantity qty) {
+        Order o(orderId, side, type, timeInForce, price, qty);  // ctor runs
         o.validate();                          // throws on bad input
-        return o;                              // o already has a unique _orderId
+        return o;
     }
 
     OrderID     getOrderId()         const { return _orderId; }
@@ -28,18 +29,24 @@ public:
         remainingQuantity -= take;
     }
 
+    // Cancel/replace: new limit price and open quantity, same id. Whatever already filled stays filled.
+    void amend(Price price, Quantity remaining) {
+        originalQuantity += remaining - remainingQuantity;
+        remainingQuantity = remaining;
+        _price = price;
+    }
+
 private:
-    Order(Side side, OrderType type, TimeInForce tif, Price price, Quantity qty)
-            : _side(side), _orderType(type), _timeInForce(tif),
+    Order(OrderID orderId, Side side, OrderType type, TimeInForce tif, Price price, Quantity qty)
+            : _orderId(orderId), _side(side), _orderType(type), _timeInForce(tif),
               _price(price), originalQuantity(qty), remainingQuantity(qty)
     {
-        _orderId = ++_nextOrderId;  // <-- assign unique id here
     }
 
     void validate() {
         if (_price <= 0)
             throw std::invalid_argument("Limit order price must be > 0");
-        if (originalQuantity == 0)
+        if (originalQuantity <= 0)
             throw std::invalid_argument("Order quantity must be > 0");
 
         if (_orderType == OrderType::MARKET) {
@@ -60,6 +67,4 @@ private:
     Price       _price{};
     Quantity    originalQuantity;
     Quantity    remainingQuantity;
-
-    inline static OrderID _nextOrderId = 0;
 };
\ No newline at end of file
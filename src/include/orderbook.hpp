@@ -2,86 +2,82 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include "portfolio.hpp"
 
 #pragma once
 #include "order.hpp"
 #include "matchingpolicy.hpp"
-
-std::random_device rd;
-std::mt19937 gen(rd());
-std::uniform_int_distribution<int> qty_dist(10, 500);
-std::uniform_real_distribution<double> micro_pct(0.0005, 0.005);
-
-using Bids = std::vector<Order>;
-using Asks = std::vector<Order>;
-
-class Orderbook {
+#include "bookbackend.hpp"
+#include "bookconfig.hpp"
+#include "orderindex.hpp"
+#include "orderid.hpp"
+#include "execution.hpp"
+#include "eventsink.hpp"
+#include "topofbook.hpp"
+#include "depthsnapshot.hpp"
+#include "bookimage.hpp"
+
+// Backend picks the price ladder (see bookbackend.hpp), Sink receives every outcome (see eventsink.hpp)
+template <typename Backend = MapBackend, EventSink Sink = NullSink>
+class BasicOrderbook {
 
 public:
 
+    using Bids = typename Backend::template Ladder<Side::BUY>;
+    using Asks = typename Backend::template Ladder<Side::SELL>;
+    using Rng = std::mt19937_64;
+
+    explicit BasicOrderbook(BookConfig config = BookConfig{}, Sink sink = Sink{})
+            : _tickSize(config.tickSize),
+              _ids(config.idPartition),
+              _index(config.orderCapacity),
+              _pool(config.orderCapacity, config.onPoolExhausted),
+              _rng(config.seed),
+              _sink(std::move(sink)) {}
+
+    // Prices are in ticks of this book's TickSize.
+    // Every random draw comes from the book's own generator, so a book constructed with the
+    // same BookConfig::seed (or reseeded to it) opens exactly the same days.
     void populateOrderbook(const Price& previousDayPrice){
-        // today's price will be 1-3% in either direction of the previous day's price
-        int percentage = 1 + rand() % 3;
-        int upOrDown = rand() % 2; // 0 = down, 1 = up
-        double changeAmount = previousDayPrice * (static_cast<double>(percentage) / 100.0);
-
-        // Compute today's price accordingly
-        Price todaysPrice = previousDayPrice;
-        if (upOrDown == 0) {
-            todaysPrice -= changeAmount;
-        } else {
-            todaysPrice += changeAmount;
-        }
-        _todaysPrice = todaysPrice;
-        std::cout << "Today's Price: " << todaysPrice << std::endl;
-
-        clearOrderbook();
-
-       // To keep things simple, generate 5 bids & asks on each new day
-       for (int i = 0; i < 5; ++i) {
-           double level = static_cast<double>(i + 1);
-
-           double bidOffset = level * micro_pct(gen);
-           Price bidPrice = todaysPrice * (1.0 - bidOffset);
-           if (bidPrice <= 0) bidPrice = std::max<Price>(0.01, todaysPrice * 0.5);
-           Quantity bidQty = qty_dist(gen);
-           auto bid = Order::create(Side::BUY, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, bidPrice, bidQty);
-           _bids.push_back(bid);
-
-           double askOffset = level * micro_pct(gen);
-           Price askPrice = todaysPrice * (1.0 + askOffset);
-           if (askPrice <= 0) askPrice = std::max<Price>(0.01, todaysPrice * 1.5);
-           Quantity askQty = qty_dist(gen);
-           auto ask = Order::create(Side::SELL, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, askPrice, askQty);
-           _asks.push_back(ask);
-       }
+        const Price todaysPrice = nextDayPrice(previousDayPrice, _rng);
+        std::cout << "Today's Price: " << _tickSize.toDouble(todaysPrice) << std::endl;
+        openDay(todaysPrice, _rng);
+    }
 
+    // Same, silently and with every random draw taken from `rng`, so a simulation path
+    // that owns its generator replays exactly from its seed
+    template <typename Generator>
+    void populateOrderbook(Price previousDayPrice, Generator& rng) {
+        openDay(nextDayPrice(previousDayPrice, rng), rng);
     }
 
     void displayOrderbook(){
-        std::sort(_bids.begin(), _bids.end(), [](const Order& a, const Order& b) {
-            return a.getPrice() > b.getPrice();
-        });
-
-        std::sort(_asks.begin(), _asks.end(), [](const Order& a, const Order& b) {
-            return a.getPrice() > b.getPrice();
-        });
-
         std::cout << "Orderbook Ladder:" << std::endl;
 
+        // Levels are already ordered, highest price printed first on both sides
         std::cout << " Asks (SELL):" << std::endl;
-        for (const auto& ask : _asks) {
-            std::cout << "  Price: " << ask.getPrice() << "  Qty: " << ask.getRemainingQuantity() << std::endl;
-        }
+        _asks.forEachWorstFirst([this](const PriceLevel& level) {
+            level.forEachOrder(_pool, [this](const Order& ask) {
+                std::cout << "  Price: " << _tickSize.toDouble(ask.getPrice()) << "  Qty: " << ask.getRemainingQuantity()
+                          << "  ID: " << ask.getOrderId() << std::endl;
+            });
+        });
 
-        std::cout << " -- TODAY'S PRICE: " << _todaysPrice << " --" << std::endl;
+        std::cout << " -- TODAY'S PRICE: " << _tickSize.toDouble(_todaysPrice) << " --";
+        if (auto s = spread()) std::cout << "  (spread " << _tickSize.toDouble(*s) << ")";
+        std::cout << std::endl;
 
 
         std::cout << " Bids (BUY):" << std::endl;
-        for (const auto& bid : _bids) {
-            std::cout << "  Price: " << bid.getPrice() << "  Qty: " << bid.getRemainingQuantity() << std::endl;
-        }
+        _bids.forEachBestFirst([this](const PriceLevel& level) {
+            level.forEachOrder(_pool, [this](const Order& bid) {
+                std::cout << "  Price: " << _tickSize.toDouble(bid.getPrice()) << "  Qty: " << bid.getRemainingQuantity()
+                          << "  ID: " << bid.getOrderId() << std::endl;
+            });
+        });
 
         std::cout << "\n\n\n";
     }
@@ -90,171 +86,492 @@ public:
         populateOrderbook(previousDayPrice);
     }
 
+    template <typename Generator>
+    void simulateNextDay(Price previousDayPrice, Generator& rng) {
+        populateOrderbook(previousDayPrice, rng);
+    }
+
+    // Restart the book's generator: the days that follow are those of a new book with this seed
+    void reseed(std::uint64_t seed) { _rng.seed(seed); }
+
     [[nodiscard]] const Bids &getBids() const { return _bids; }
 
     [[nodiscard]] const Asks &getAsks() const { return _asks; }
 
+    // Cached best level of each side, kept current on every rest, fill, modify and cancel
+    [[nodiscard]] const TopOfBook &bestBid() const { return _bestBid; }
+
+    [[nodiscard]] const TopOfBook &bestAsk() const { return _bestAsk; }
+
+    // Best ask minus best bid in ticks, if both sides have orders
+    [[nodiscard]] std::optional<Price> spread() const {
+        if (_bestBid.empty() || _bestAsk.empty()) return std::nullopt;
+        return _bestAsk.price - _bestBid.price;
+    }
+
+    // Midpoint of best bid and best ask in ticks (may fall between two ticks)
+    [[nodiscard]] std::optional<double> mid() const {
+        if (_bestBid.empty() || _bestAsk.empty()) return std::nullopt;
+        return (static_cast<double>(_bestBid.price) + static_cast<double>(_bestAsk.price)) / 2.0;
+    }
+
     [[nodiscard]] Price getTodaysPrice() const { return _todaysPrice; }
 
-    void executeMarketOrder(const Portfolio& portfolio){
+    [[nodiscard]] const TickSize &getTickSize() const { return _tickSize; }
 
-        if (_bids.empty() && _asks.empty()) {
-            std::cout << "Orderbook is empty. Nothing to execute.\n";
-            return;
-        }
+    [[nodiscard]] const OrderPool &getOrderPool() const { return _pool; }
 
-        // determine if user wants buy or sell
-        char buyOrSell{};
-        std::cout << "Do you want to buy or sell? (B=BUY, S=SELL): ";
-        std::cin >> buyOrSell;
-        buyOrSell = static_cast<char>(std::toupper(static_cast<unsigned char>(buyOrSell)));
-        if (buyOrSell != 'B' && buyOrSell != 'S') {
-            std::cout << "Invalid side.\n";
-            return;
-        }
-        Side side = (buyOrSell == 'B') ? Side::BUY : Side::SELL;
-
-        // inquiry about time restrictions (for MARKET orders, use FOK or IOC)
-        int timeInForce{};
-        std::cout << "Do you want\n"
-                     "1. Fill or Kill\n"
-                     "2. Immediate or Cancel\n";
-        std::cin >> timeInForce;
-        if (timeInForce != 1 && timeInForce != 2) {
-            std::cout << "Invalid time-in-force choice.\n";
-            return;
+    [[nodiscard]] const OrderIdGenerator &getOrderIds() const { return _ids; }
+
+    Sink &getSink() { return _sink; }
+
+    // Remove a resting order. O(1) to locate it via the order index and unlink it from its level.
+    bool cancel(OrderID orderId) {
+        if (!removeOrder(orderId, CancelReason::USER_REQUESTED)) return false;
+        _sink.flush();
+        return true;
+    }
+
+    // Change a resting order's open quantity and/or limit price, keeping its id.
+    // Reducing quantity at the same price amends in place and keeps time priority.
+    // Any price change or quantity increase is a cancel/replace: the order loses its
+    // place in the queue and is matched again at the new price, like a new GTC limit;
+    // pass `replacement` to get the execution report of that re-entry.
+    bool modify(OrderID orderId, Quantity newQuantity, Price newPrice, ExecutionReport* replacement = nullptr) {
+        if (newQuantity <= 0 || newPrice <= 0) return false;
+        PoolIndex* found = _index.find(orderId);
+        if (found == nullptr) return false;
+
+        Order& resting = _pool[*found].order;
+        if (newPrice == resting.getPrice() && newQuantity <= resting.getRemainingQuantity()) {
+            const Quantity reduceBy = resting.getRemainingQuantity() - newQuantity;
+            resting.reduceRemainingQuantity(reduceBy);
+            levelOf(resting).reduce(reduceBy);
+            refreshTop(resting.getSide());
+            _sink.onModify(resting);
+            _sink.flush();
+            return true;
         }
-        TimeInForce tif = (timeInForce == 1) ? TimeInForce::FILL_OR_KILL : TimeInForce::IMMEDIATE_OR_CANCEL;
-
-        // pick a reference price for MARKET order from the best opposite side
-        Price price{};
-        if (side == Side::BUY) {
-            if (_asks.empty()) { std::cout << "No asks available.\n"; return; }
-            auto it = std::min_element(_asks.begin(), _asks.end(), [](const Order& a, const Order& b){
-                return a.getPrice() < b.getPrice();
-            });
-            price = it->getPrice();
-        } else {
-            if (_bids.empty()) { std::cout << "No bids available.\n"; return; }
-            auto it = std::max_element(_bids.begin(), _bids.end(), [](const Order& a, const Order& b){
-                return a.getPrice() < b.getPrice();
+
+        Order amended = resting;
+        amended.amend(newPrice, newQuantity);
+        removeOrder(orderId, CancelReason::REPLACED);
+
+        ExecutionReport discarded;
+        ExecutionReport& report = replacement ? *replacement : discarded;
+        report.reset();
+        matchingEngine(amended, report);
+        _sink.flush();
+        return true;
+    }
+
+    // Total open quantity resting on `side` at `price` or better (bids at or above it,
+    // asks at or below it). Walks levels, not orders, using the per-level totals.
+    [[nodiscard]] Quantity depthUpTo(Side side, Price price) const {
+        Quantity depth = 0;
+        auto add = [&](const PriceLevel& level) {
+            const bool inRange = (side == Side::BUY) ? level.price >= price : level.price <= price;
+            if (inRange) depth += level.quantity;
+            return inRange;
+        };
+        if (side == Side::BUY) _bids.forEachBestFirstWhile(add);
+        else                   _asks.forEachBestFirstWhile(add);
+        return depth;
+    }
+
+    // Copy the best Depth levels of each side into `out`. Walks at most Depth levels per side
+    // and never the orders in them, so the cost is bounded whatever the size of the book.
+    template <std::size_t Depth>
+    void snapshotDepth(DepthSnapshot<Depth>& out) const {
+        auto fill = [](const auto& ladder, std::array<DepthLevel, Depth>& levels, std::uint32_t& count) {
+            count = 0;
+            ladder.forEachBestFirstWhile([&](const PriceLevel& level) {
+                if (count == Depth) return false;
+                levels[count++] = DepthLevel{level.price, level.quantity, level.orderCount};
+                return true;
             });
-            price = it->getPrice();
-        }
+        };
+        fill(_bids, out.bids, out.bidLevels);
+        fill(_asks, out.asks, out.askLevels);
+    }
 
-        // enter quantity
-        Quantity quantity{};
-        std::cout << "What quantity do you want: ";
-        std::cin >> quantity;
-        if (quantity <= 0) {
-            std::cout << "Quantity must be > 0.\n";
-            return;
-        }
+    // The resting order with this id, or nullptr
+    [[nodiscard]] const Order* findOrder(OrderID orderId) const {
+        const PoolIndex* found = _index.find(orderId);
+        return found ? &_pool[*found].order : nullptr;
+    }
 
-        // Based on data collected, generate the MARKET order
-        Order order = Order::create(side, OrderType::MARKET, tif, price, quantity);
-        try {
-            std::cout << "Created order id " << order.getOrderId()
-                      << " | " << ((side == Side::BUY) ? "BUY" : "SELL")
-                      << " " << quantity
-                      << " @ MKT $" << price
-                      << " | Time In Force=" << ((tif == TimeInForce::FILL_OR_KILL) ? "Fill Or Kill" : "Immediate or Cancel")
-                      << "\n";
-        } catch (const std::exception& ex) {
-            std::cout << "Failed to create order: " << ex.what() << "\n";
+    // Backends with a price band (DenseBackend) move it to be centered on `price`; no-op otherwise
+    void recenter(Price price) {
+        if constexpr (requires { _bids.recenter(price); }) {
+            _bids.recenter(price);
+            _asks.recenter(price);
         }
+    }
 
-        matchingEngine(order);
+    // Headless entry point: match a new order and report what happened.
+    ExecutionReport submit(const OrderRequest& request) {
+        ExecutionReport report;
+        submit(request, report);
+        return report;
+    }
 
+    // Same, writing into a caller-owned report whose fill storage is reused
+    void submit(const OrderRequest& request, ExecutionReport& report) {
+        submitOne(request, report);
+        _sink.flush();
+    }
 
+    // Match a burst of orders in one pass. reports[i] receives the outcome of requests[i];
+    // results are exactly those of calling submit() on each request in order, but the sink is
+    // flushed once for the whole batch and the reports' fill storage is reused across calls.
+    void submitBatch(std::span<const OrderRequest> requests, std::span<ExecutionReport> reports) {
+        if (reports.size() < requests.size())
+            throw std::invalid_argument("submitBatch needs one report per request");
 
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            submitOne(requests[i], reports[i]);
+        }
+        _sink.flush();
     }
 
-    void executeLimitOrder() {
-        // Side
-        char buyOrSell{};
-        std::cout << "Limit order: Do you want to buy or sell? (B=BUY, S=SELL): ";
-        std::cin >> buyOrSell;
-        buyOrSell = static_cast<char>(std::toupper(static_cast<unsigned char>(buyOrSell)));
-        if (buyOrSell != 'B' && buyOrSell != 'S') {
-            std::cout << "Invalid side.\n";
-            return;
+    // Copy the whole book into `out` (reusing its storage). One pass over the resting orders,
+    // no allocation once `out` has grown to the size of the book.
+    void capture(BookImage& out) const {
+        out.todaysPrice = _todaysPrice;
+        out.lastOrderId = _ids.last();
+        out.orders.clear();
+        auto add = [&](const PriceLevel& level) {
+            level.forEachOrder(_pool, [&](const Order& order) {
+                out.orders.push_back(ImageOrder{order.getOrderId(), order.getPrice(), order.getRemainingQuantity(),
+                                                order.getOriginalQuantity(), order.getSide()});
+            });
+        };
+        _bids.forEachBestFirst(add);
+        _asks.forEachBestFirst(add);
+    }
+
+    // Rebuild a new book from a captured image: every order back in its level in the same
+    // priority, with its id and quantities, and ids issued afterwards continuing from it.
+    // Nothing is reported to the sink.
+    void restore(const BookImage& image) {
+        clearOrderbook();
+        _todaysPrice = image.todaysPrice;
+        if (image.todaysPrice > 0) recenter(image.todaysPrice);
+        _ids.resumeAfter(image.lastOrderId);
+        for (const ImageOrder& resting : image.orders) {
+            Order order = Order::create(resting.orderId, resting.side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL,
+                                        resting.price, resting.original);
+            order.reduceRemainingQuantity(resting.original - resting.remaining);
+            if (resting.side == Side::BUY) placeOrder(_bids, order);
+            else                           placeOrder(_asks, order);
         }
-        Side side = (buyOrSell == 'B') ? Side::BUY : Side::SELL;
-
-        // Time-in-force (for LIMIT: GTC or FOK)
-        int tifChoice{};
-        std::cout << "Time In Force\n"
-                     "1. Good Till Cancel (GTC)\n"
-                     "2. Fill or Kill (FOK)\n"
-                     "Choose: ";
-        std::cin >> tifChoice;
-        if (tifChoice != 1 && tifChoice != 2) {
-            std::cout << "Invalid TIF choice.\n";
-            return;
+    }
+
+    // Open a day on a loaded book instead of a synthetic one: the book is emptied and every
+    // order placed with a new id in the order given, which is time priority within a level.
+    // The orders are read twice: once to check them and find the touch, once to place them.
+    // Both sides are placed in that one scan, each keeping the level it last placed into, so
+    // consecutive orders of a side at the same price (a file grouped by level) skip the lookup;
+    // the best prices are read once at the end, so no order pays for a top-of-book update.
+    // todaysPrice 0 takes the mid of the loaded touch. The sink gets the day and every rest.
+    // Throws std::invalid_argument, leaving the book as it was, if an order has an unknown side,
+    // a price or quantity <= 0, or the bids reach the asks. Returns the orders placed: all of them unless
+    // the pool runs out under PoolExhaustion::REJECT.
+    std::size_t loadOpeningBook(std::span<const OpeningOrder> orders, Price todaysPrice = 0) {
+        Price bestBid = 0;
+        Price bestAsk = 0;
+        for (const OpeningOrder& order : orders) {
+            if (order.price <= 0 || order.quantity <= 0) throw std::invalid_argument("Opening book order with price or quantity <= 0");
+            if (order.side != Side::BUY && order.side != Side::SELL) throw std::invalid_argument("Opening book order with an unknown side");
+            if (order.side == Side::BUY) bestBid = std::max(bestBid, order.price);
+            else                         bestAsk = bestAsk == 0 ? order.price : std::min(bestAsk, order.price);
         }
-        TimeInForce tif = (tifChoice == 1) ? TimeInForce::GOOD_TILL_CANCEL
-                                           : TimeInForce::FILL_OR_KILL;
-
-        // Price
-        Price price{};
-        std::cout << "Limit Price: ";
-        std::cin >> price;
-        if (price <= 0.0) {
-            std::cout << "Price must be > 0.\n";
-            return;
+        if (bestBid != 0 && bestAsk != 0 && bestBid >= bestAsk) throw std::invalid_argument("Opening book is crossed");
+        if (todaysPrice <= 0) todaysPrice = bestBid && bestAsk ? (bestBid + bestAsk) / 2 : std::max(bestBid, bestAsk);
+
+        beginDay(todaysPrice);
+        _sink.onOpenDay(todaysPrice);
+        std::size_t placed = 0;
+        PriceLevel* bidLevel = nullptr;
+        PriceLevel* askLevel = nullptr;
+        for (const OpeningOrder& order : orders) {
+            const bool rested = order.side == Side::BUY ? placeOpening(_bids, bidLevel, order)
+                                                        : placeOpening(_asks, askLevel, order);
+            if (!rested) break;
+            ++placed;
         }
+        refreshTop(Side::BUY);
+        refreshTop(Side::SELL);
+        _sink.flush();
+        return placed;
+    }
 
-        // Quantity
-        Quantity quantity{};
-        std::cout << "Quantity: ";
-        std::cin >> quantity;
-        if (quantity <= 0) {
-            std::cout << "Quantity must be > 0.\n";
-            return;
+    // Re-apply one recorded outcome (an EventRecord as journaled by JournalSink) to rebuild the
+    // book as it was: OPEN_DAY empties the book at today's price, REST puts the order back at
+    // the back of its level with its original id, FILL / MODIFY reduce the resting order and
+    // CANCEL takes it off. Nothing is matched and the sink isn't told. The id generator is
+    // moved past every id seen, and past the one each REJECT used up, so ids issued
+    // afterwards are exactly those the original book would have issued.
+    void replay(const EventRecord& event) {
+        _ids.resumeAfter(event.orderId);
+        switch (event.type) {
+            case EventRecord::Type::OPEN_DAY:
+                beginDay(event.price);
+                break;
+            case EventRecord::Type::REST: {
+                // Only GTC limits ever rest. A remainder comes back with what its taker filled
+                // just before (or kept from before a cancel/replace) as filled quantity.
+                const Quantity filled = (_replayTaker == event.orderId) ? _replayFilled : 0;
+                Order order = Order::create(event.orderId, event.side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL,
+                                            event.price, event.quantity + filled);
+                order.reduceRemainingQuantity(filled);
+                if (event.side == Side::BUY) placeOrder(_bids, order);
+                else                         placeOrder(_asks, order);
+                _replayTaker = 0;
+                break;
+            }
+            case EventRecord::Type::FILL:
+                if (_replayTaker != event.orderId) {
+                    _replayTaker = event.orderId;
+                    _replayFilled = 0;
+                }
+                _replayFilled += event.quantity;
+                [[fallthrough]];
+            case EventRecord::Type::MODIFY: {
+                PoolIndex* found = _index.find(event.type == EventRecord::Type::FILL ? event.otherId : event.orderId);
+                if (found == nullptr) break;
+                const PoolIndex node = *found;
+                Order& resting = _pool[node].order;
+                const Quantity reduceBy = event.type == EventRecord::Type::FILL
+                                          ? event.quantity : resting.getRemainingQuantity() - event.quantity;
+                resting.reduceRemainingQuantity(reduceBy);
+                levelOf(resting).reduce(reduceBy);
+                if (resting.getRemainingQuantity() == 0) dropOrder(resting.getOrderId(), node);
+                else                                     refreshTop(resting.getSide());
+                break;
+            }
+            case EventRecord::Type::CANCEL:
+                if (const PoolIndex* found = _index.find(event.orderId)) {
+                    if (event.reason == CancelReason::REPLACED) {
+                        const Order& replaced = _pool[*found].order;
+                        _replayTaker = event.orderId;
+                        _replayFilled = replaced.getOriginalQuantity() - replaced.getRemainingQuantity();
+                    }
+                    dropOrder(event.orderId, *found);
+                }
+                break;
+            case EventRecord::Type::REJECT:
+                _ids.next();        // submit() drew an id before the request failed validation
+                break;
         }
-
-        // Create & route
-        Order order = Order::create(side, OrderType::LIMIT, tif, price, quantity);
-        std::cout << "Created LIMIT order id " << order.getOrderId()
-                  << " | " << ((side == Side::BUY) ? "BUY" : "SELL")
-                  << " " << quantity << " @ $" << price
-                  << " | TIF=" << ((tif == TimeInForce::GOOD_TILL_CANCEL) ? "GTC" : "FOK") << "\n";
-
-        matchingEngine(order);
     }
 
-
 private:
     Bids _bids;
     Asks _asks;
-    Price _todaysPrice;
+    TopOfBook _bestBid;
+    TopOfBook _bestAsk;
+    Price _todaysPrice{};
+    TickSize _tickSize;
+    OrderIdGenerator _ids;
+    OrderIndex<PoolIndex> _index;     // OrderID -> pool node of every resting order
+    OrderPool _pool;
+    Rng _rng;                         // synthetic days (populateOrderbook), seeded from BookConfig::seed
+    OrderID _replayTaker{0};          // replay(): order whose fills / kept quantity are in _replayFilled
+    Quantity _replayFilled{0};
+    [[no_unique_address]] Sink _sink;
 
     void clearOrderbook(){
         _bids.clear();
         _asks.clear();
+        _index.clear();
+        _pool.clear();
+        _bestBid = TopOfBook{};
+        _bestAsk = TopOfBook{};
+        _replayTaker = 0;                 // a taker from before can't come back to this book
+        _replayFilled = 0;
+    }
+
+    // Re-read the best level of one side into its TopOfBook. O(1) on both backends.
+    void refreshTop(Side side) {
+        if (side == Side::BUY) _bestBid = TopOfBook::of(_bids.best());
+        else                   _bestAsk = TopOfBook::of(_asks.best());
+    }
+
+    // Today's price is 1-3% in either direction of the previous day's, on the closest tick
+    template <typename Generator>
+    static Price nextDayPrice(Price previousDayPrice, Generator& rng) {
+        const int percentage = std::uniform_int_distribution<int>(1, 3)(rng);
+        const bool up = std::bernoulli_distribution(0.5)(rng);
+        const double changeAmount = static_cast<double>(previousDayPrice) * (static_cast<double>(percentage) / 100.0);
+
+        const Price todaysPrice = previousDayPrice + std::llround(up ? changeAmount : -changeAmount);
+        return todaysPrice > 0 ? todaysPrice : 1;
+    }
+
+    // Empty book, centered on today's price
+    void beginDay(Price todaysPrice) {
+        _todaysPrice = todaysPrice;
+        clearOrderbook();
+        recenter(todaysPrice);
+    }
+
+    // Start a new day at `todaysPrice` with an empty book and a few synthetic levels
+    template <typename Generator>
+    void openDay(Price todaysPrice, Generator& rng) {
+        beginDay(todaysPrice);
+        _sink.onOpenDay(todaysPrice);
+
+        std::uniform_int_distribution<int> qtyDist(10, 500);
+        std::uniform_real_distribution<double> microPct(0.0005, 0.005);
+
+       // To keep things simple, generate 5 bids & asks on each new day.
+       // Bids round down and asks round up to a tick so the synthetic book never crosses.
+       for (int i = 0; i < 5; ++i) {
+           double level = static_cast<double>(i + 1);
+
+           double bidOffset = level * microPct(rng);
+           Price bidPrice = static_cast<Price>(std::floor(static_cast<double>(todaysPrice) * (1.0 - bidOffset)));
+           if (bidPrice <= 0) bidPrice = std::max<Price>(1, todaysPrice / 2);
+           Quantity bidQty = qtyDist(rng);
+           auto bid = Order::create(_ids.next(), Side::BUY, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, bidPrice, bidQty);
+           restOrder(_bids, bid);
+
+           double askOffset = level * microPct(rng);
+           Price askPrice = static_cast<Price>(std::ceil(static_cast<double>(todaysPrice) * (1.0 + askOffset)));
+           if (askPrice <= 0) askPrice = std::max<Price>(1, todaysPrice + todaysPrice / 2);
+           Quantity askQty = qtyDist(rng);
+           auto ask = Order::create(_ids.next(), Side::SELL, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, askPrice, askQty);
+           restOrder(_asks, ask);
+       }
+       _sink.flush();
+    }
+
+    // Every order that rests goes through here so it is stored in the pool and reachable by id.
+    // False if the pool is exhausted under PoolExhaustion::REJECT; the order did not rest.
+    template <typename Ladder>
+    bool restOrder(Ladder& ladder, const Order& order) {
+        if (!placeOrder(ladder, order)) return false;
+        _sink.onRest(order);
+        return true;
+    }
+
+    // restOrder() without telling the sink
+    template <typename Ladder>
+    bool placeOrder(Ladder& ladder, const Order& order) {
+        const PoolIndex node = _pool.allocate(order);
+        if (node == NullIndex) return false;
+        ladder.levelFor(order.getPrice()).push(_pool, node);
+        _index.insert(order.getOrderId(), node);
+        refreshTop(order.getSide());
+        return true;
+    }
+
+    // loadOpeningBook(): rest one loaded order, reusing `level` while the price stays the same
+    template <typename Ladder>
+    bool placeOpening(Ladder& ladder, PriceLevel*& level, const OpeningOrder& loaded) {
+        const Order order = Order::create(_ids.next(), loaded.side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL,
+                                          loaded.price, loaded.quantity);
+        const PoolIndex node = _pool.allocate(order);
+        if (node == NullIndex) return false;
+        if (level == nullptr || level->price != loaded.price) level = &ladder.levelFor(loaded.price);
+        level->push(_pool, node);
+        _index.insert(order.getOrderId(), node);
+        _sink.onRest(order);
+        return true;
+    }
+
+    // Take a resting order off the book, reporting it canceled for `reason`
+    bool removeOrder(OrderID orderId, CancelReason reason) {
+        PoolIndex* found = _index.find(orderId);
+        if (found == nullptr) return false;
+
+        const Order& order = _pool[*found].order;
+        _sink.onCancel(orderId, order.getSide(), order.getRemainingQuantity(), reason);
+        dropOrder(orderId, *found);
+        return true;
+    }
+
+    // Take a resting order off the book without telling the sink
+    void dropOrder(OrderID orderId, PoolIndex node) {
+        const Side side = _pool[node].order.getSide();
+        _index.erase(orderId);
+        if (side == Side::BUY) unlinkOrder(_bids, node);
+        else                   unlinkOrder(_asks, node);
+    }
+
+    template <typename Ladder>
+    void unlinkOrder(Ladder& ladder, PoolIndex node) {
+        const Price price = _pool[node].order.getPrice();
+        const Side side = _pool[node].order.getSide();
+        PriceLevel* level = ladder.find(price);
+        level->unlink(_pool, node);
+        _pool.release(node);
+        if (level->empty()) ladder.erase(price);
+        refreshTop(side);
+    }
+
+    // The level a resting order sits in
+    PriceLevel& levelOf(const Order& order) {
+        return *(order.getSide() == Side::BUY ? _bids.find(order.getPrice()) : _asks.find(order.getPrice()));
     }
 
-    // Helper: best-first sort & price acceptance
-    static inline void sort_best_first(std::vector<Order>& book, Side takerSide) {
-        if (takerSide == Side::BUY) {
-            // BUY hits asks: best (lowest) ask first
-            std::sort(book.begin(), book.end(),
-                      [](const Order& a, const Order& b){ return a.getPrice() < b.getPrice(); });
-        } else {
-            // SELL hits bids: best (highest) bid first
-            std::sort(book.begin(), book.end(),
-                      [](const Order& a, const Order& b){ return a.getPrice() > b.getPrice(); });
+    // Helper: price acceptance (integer ticks, see matchingpolicy.hpp)
+    static inline bool price_is_acceptable(const Order& taker, Price resting) {
+        return ::price_is_acceptable(taker.getOrderType(), taker.getSide(), taker.getPrice(), resting);
+    }
+
+    // submit() without the sink flush, so batches can flush once
+    void submitOne(const OrderRequest& request, ExecutionReport& report) {
+        report.reset();
+
+        // MARKET orders have no limit of their own; they carry the best opposite price as reference
+        Price price = request.price;
+        if (request.type == OrderType::MARKET) {
+            const TopOfBook& best = (request.side == Side::BUY) ? _bestAsk : _bestBid;
+            if (best.empty()) {
+                report.status = OrderStatus::CANCELED;
+                report.cancelReason = CancelReason::NO_LIQUIDITY;
+                report.canceledQuantity = request.quantity;
+                _sink.onCancel(0, request.side, request.quantity, CancelReason::NO_LIQUIDITY);
+                return;
+            }
+            price = best.price;
         }
+
+        std::optional<Order> order;
+        try {
+            order = Order::create(_ids.next(), request.side, request.type, request.timeInForce, price, request.quantity);
+        } catch (const std::invalid_argument&) {
+            report.status = OrderStatus::REJECTED;
+            report.cancelReason = CancelReason::INVALID_ORDER;
+            report.canceledQuantity = request.quantity;
+            _sink.onReject(request, CancelReason::INVALID_ORDER);
+            return;
+        }
+        matchingEngine(*order, report);
     }
 
-    static inline bool price_is_acceptable(const Order& taker, const Order& resting) {
-        if (taker.getOrderType() == OrderType::MARKET) return true;
-        if (taker.getSide() == Side::BUY)  return resting.getPrice() <= taker.getPrice();
-        else                                return resting.getPrice() >= taker.getPrice();
+    void matchingEngine(const Order& taker, ExecutionReport& report) {
+        if (taker.getSide() == Side::BUY) matchingEngine(taker, report, _asks, _bids);
+        else                              matchingEngine(taker, report, _bids, _asks);
     }
 
-    void matchingEngine(const Order& taker) {
+    // `opposite` is the side the taker trades against, `myside` is where a remainder rests.
+    // Both are ladders of price levels kept best-first, so there is nothing to sort here.
+    // Outcomes go into `report` (expected to be reset); nothing is printed.
+    template <typename Opposite, typename MySide>
+    void matchingEngine(const Order& taker, ExecutionReport& report, Opposite& opposite, MySide& myside) {
+        report.orderId = taker.getOrderId();
+
+        // Anything not filled or rested by the end is canceled for `reason`
+        auto cancelRemainder = [&](Quantity remaining, CancelReason reason) {
+            report.status = (reason == CancelReason::INVALID_ORDER) ? OrderStatus::REJECTED : OrderStatus::CANCELED;
+            report.cancelReason = reason;
+            report.canceledQuantity = remaining;
+            _sink.onCancel(taker.getOrderId(), taker.getSide(), remaining, reason);
+        };
 
         // 0) Validate allowed TIF combos
         const OrderType ot  = taker.getOrderType();
@@ -263,129 +580,120 @@ private:
                 (ot == OrderType::MARKET && (tif == TimeInForce::FILL_OR_KILL || tif == TimeInForce::IMMEDIATE_OR_CANCEL)) ||
                 (ot == OrderType::LIMIT  && (tif == TimeInForce::FILL_OR_KILL || tif == TimeInForce::GOOD_TILL_CANCEL));
         if (!tif_ok) {
-            std::cout << "Invalid TIF for this order type (per your rules). Canceled.\n";
+            cancelRemainder(taker.getRemainingQuantity(), CancelReason::INVALID_ORDER);
             return;
         }
 
         // 1) Policy
-        MatchingPolicy policy = policyFor(ot, tif);
+        const MatchingPolicy& policy = cachedPolicyFor(ot, tif);
 
-        // 2) Choose opposite side of the book AND my side (for potential resting)
-        std::vector<Order>& opposite = (taker.getSide() == Side::BUY) ? _asks : _bids;
-        std::vector<Order>& myside   = (taker.getSide() == Side::BUY) ? _bids : _asks;
+        Quantity want = taker.getRemainingQuantity();
+        Quantity remaining = want;
 
-        // If no liquidity on the other side:
+        // 2) If no liquidity on the other side:
         if (opposite.empty()) {
             if (ot == OrderType::LIMIT && policy.rest_unfilled_remainder_on_book) {
-                // Rest the entire taker order as-is on its own side
-                myside.push_back(taker);
-                // Keep ladder tidy (asks asc, bids desc)
-                if (taker.getSide() == Side::BUY) {
-                    std::sort(myside.begin(), myside.end(), [](const Order& a, const Order& b){ return a.getPrice() > b.getPrice(); }); // bids desc
+                // Rest the entire taker order as-is at the back of its price level
+                if (restOrder(myside, taker)) {
+                    report.status = OrderStatus::RESTING;
+                    report.restingQuantity = remaining;
                 } else {
-                    std::sort(myside.begin(), myside.end(), [](const Order& a, const Order& b){ return a.getPrice() < b.getPrice(); }); // asks asc
+                    cancelRemainder(remaining, CancelReason::BOOK_FULL);
                 }
-                std::cout << "No liquidity. LIMIT+GTC order rested on book.\n";
             } else {
-                std::cout << "No liquidity. Order canceled.\n";
+                cancelRemainder(remaining, CancelReason::NO_LIQUIDITY);
             }
             return;
         }
 
-        // Sort opposite best-first (asks asc, bids desc)
-        sort_best_first(opposite, taker.getSide());
-
-        Quantity want = taker.getOriginalQuantity();
-        Quantity remaining = want;
-        Quantity filled = 0;
-        double   notional = 0.0;
-
         // 3) FOK pre-check: is there enough acceptable liquidity right now?
         if (policy.require_full_immediate_fill) {
+            //    One step per acceptable level thanks to the level totals, stopping once covered.
             Quantity possible = 0;
-            for (const auto& r : opposite) {
-                if (!price_is_acceptable(taker, r)) break;
-                possible += r.getRemainingQuantity();
-                if (possible >= want) break;
-            }
+            opposite.forEachBestFirstWhile([&](const PriceLevel& level) {
+                if (!price_is_acceptable(taker, level.price)) return false;
+                possible += level.quantity;
+                return possible < want;
+            });
             if (possible < want) {
-                std::cout << "FOK not fully fillable immediately. Canceled.\n";
+                cancelRemainder(remaining, CancelReason::FOK_NOT_FILLABLE);
                 return;
             }
         }
 
-        // 4) Execute against book (mutation: decrement resting orders)
-        for (auto& r : opposite) {
-            if (remaining == 0) break;
-            if (!price_is_acceptable(taker, r)) break;
-
-            Quantity avail = r.getRemainingQuantity();
-            if (avail <= 0) continue;
-
-            Quantity take = std::min(remaining, avail);
-
-            // (Optional) Portfolio checks could go here (affordability / inventory)
-            // e.g., if taker.getSide()==Side::BUY && !portfolio.canAfford(r.getPrice(), take)) { ...trim take... }
-
-            filled    += take;
-            notional  += r.getPrice() * static_cast<double>(take);
-            remaining -= take;
+        // 4) Execute against book, best level first and oldest order first within a level.
+        //    Fully filled resting orders are popped, and emptied levels removed, as we go.
+        while (remaining > 0) {
+            PriceLevel* level = opposite.best();
+            if (level == nullptr) break;
+            if (!price_is_acceptable(taker, level->price)) break;
+
+            while (remaining > 0 && !level->empty()) {
+                const PoolIndex node = level->head;
+                Order& r = _pool[node].order;
+                Quantity take = std::min(remaining, r.getRemainingQuantity());
+
+                // (Optional) Portfolio checks could go here (affordability / inventory)
+                // e.g., if taker.getSide()==Side::BUY && !portfolio.canAfford(level->price, take)) { ...trim take... }
+
+                _sink.onFill(taker, r, level->price, take);
+                report.fills.push_back(Fill{r.getOrderId(), level->price, take});
+                report.filledQuantity += take;
+                report.notional       += level->price * take;
+                remaining -= take;
+
+                r.reduceRemainingQuantity(take);
+                level->reduce(take);
+                if (r.getRemainingQuantity() == 0) {
+                    _index.erase(r.getOrderId());
+                    level->unlink(_pool, node);
+                    _pool.release(node);
+                }
+            }
 
-            r.reduceRemainingQuantity(take);
+            if (level->empty()) opposite.erase(level->price);
         }
-
-        const bool full_filled = (remaining == 0);
+        if (report.filledQuantity > 0) refreshTop(taker.getSide() == Side::BUY ? Side::SELL : Side::BUY);
 
         // 5) Policy outcomes
-        if (policy.require_full_immediate_fill && !full_filled) {
-            std::cout << "FOK could not fill completely after check. Canceled.\n";
-            // (Optional) If you had applied any portfolio changes, you'd rollback here.
-            // Since we only mutated resting orders, there's nothing to 'unfill' on taker.
-            // In a real engine you'd avoid needing rollback by pre-checking, as done above.
+        if (remaining == 0) {
+            report.status = OrderStatus::FILLED;
             return;
         }
 
-        if (!full_filled && !policy.allow_partial_immediate_execution) {
-            std::cout << "Partial fill not allowed by policy. Canceled remainder.\n";
-            // Do not rest remainder for Market; this branch is mainly here for future policies.
-            // For your rules, MARKET only has FOK/IOC and we already allowed partial for IOC.
+        if (policy.require_full_immediate_fill) {
+            // Can't happen after the pre-check above; in a real engine with rollback needs
+            // (e.g. portfolio changes) this is where they would be undone.
+            cancelRemainder(remaining, CancelReason::FOK_NOT_FILLABLE);
+            return;
+        }
+
+        if (!policy.allow_partial_immediate_execution) {
+            // No current policy gets here (only FOK disallows partials); kept for future policies
+            cancelRemainder(remaining, CancelReason::IOC_REMAINDER);
+            return;
         }
 
-        // If LIMIT + GTC and remainder exists: rest the remainder on our side
-        if (ot == OrderType::LIMIT && policy.rest_unfilled_remainder_on_book && remaining > 0) {
-            Order rest = Order::create(
-                    taker.getSide(),
-                    OrderType::LIMIT,
-                    TimeInForce::GOOD_TILL_CANCEL,
-                    taker.getPrice(),
-                    remaining
-            );
-            myside.push_back(rest);
-            // Keep my side sorted too
-            if (taker.getSide() == Side::BUY) {
-                std::sort(myside.begin(), myside.end(), [](const Order& a, const Order& b){ return a.getPrice() > b.getPrice(); }); // bids desc
+        // If LIMIT + GTC and remainder exists: rest the remainder at the back of its price level.
+        // It keeps the taker's id so it can be canceled/modified later.
+        if (ot == OrderType::LIMIT && policy.rest_unfilled_remainder_on_book) {
+            Order rest = taker;
+            rest.reduceRemainingQuantity(report.filledQuantity);
+            if (restOrder(myside, rest)) {
+                report.status = report.filledQuantity ? OrderStatus::PARTIALLY_FILLED : OrderStatus::RESTING;
+                report.restingQuantity = remaining;
             } else {
-                std::sort(myside.begin(), myside.end(), [](const Order& a, const Order& b){ return a.getPrice() < b.getPrice(); }); // asks asc
+                cancelRemainder(remaining, CancelReason::BOOK_FULL);
             }
+            return;
         }
 
-        // 6) Cleanup: remove fully filled resting orders
-        opposite.erase(
-                std::remove_if(opposite.begin(), opposite.end(),
-                               [](const Order& r){ return r.getRemainingQuantity() == 0; }),
-                opposite.end()
-        );
-
-        // 7) Report
-        std::cout << (taker.getSide() == Side::BUY ? "BUY " : "SELL ")
-                  << filled << " shares"
-                  << (full_filled ? " (FULL)" : " (PARTIAL)")
-                  << " @ VWAP $" << (filled ? notional / static_cast<double>(filled) : 0.0)
-                  << " | Notional $" << notional
-                  << ((ot == OrderType::LIMIT && policy.rest_unfilled_remainder_on_book && remaining > 0)
-                      ? " | Remainder rested on book" : "")
-                  << "\n";
+        // Partial immediate execution (IOC and friends): the remainder doesn't rest
+        cancelRemainder(remaining, CancelReason::IOC_REMAINDER);
     }
 
 
-};
\ No newline at end of file
+};
+
+using Orderbook      = BasicOrderbook<MapBackend>;
+using DenseOrderbook = BasicOrderbook<DenseBackend<>>;
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include "order.hpp"
+
+// Issues the OrderIDs of one book. An id is [partition : 16 bits | sequence : 48 bits]:
+// every book gets its own partition (the engine uses the SymbolId), so ids are unique across
+// all books without any shared counter, and the owning book / shard is one shift away.
+// Within a book ids are strictly increasing. Not thread-safe: only the book's thread uses it.
+class OrderIdGenerator {
+public:
+    static constexpr unsigned      SequenceBits = 48;
+    static constexpr std::uint32_t MaxPartition = (1u << (64 - SequenceBits)) - 1;
+    static constexpr OrderID       SequenceMask = (OrderID{1} << SequenceBits) - 1;
+
+    explicit OrderIdGenerator(std::uint32_t partition = 0) : _partition(partition) {
+        if (partition > MaxPartition) throw std::invalid_argument("OrderID partition out of range");
+    }
+
+    OrderID next() { return compose(_partition, ++_lastSequence); }
+
+    // Last id issued, or 0 (never a valid id) if none yet
+    [[nodiscard]] OrderID last() const { return _lastSequence ? compose(_partition, _lastSequence) : 0; }
+
+    // Continue after `id` (e.g. when restoring a book); ignored if it is from another partition
+    // or not ahead of what was issued already
+    void resumeAfter(OrderID id) {
+        if (partitionOf(id) == _partition && sequenceOf(id) > _lastSequence) _lastSequence = sequenceOf(id);
+    }
+
+    [[nodiscard]] std::uint32_t partition() const { return _partition; }
+
+    static constexpr OrderID compose(std::uint32_t partition, OrderID sequence) {
+        return (static_cast<OrderID>(partition) << SequenceBits) | (sequence & SequenceMask);
+    }
+
+    static constexpr std::uint32_t partitionOf(OrderID id) { return static_cast<std::uint32_t>(id >> SequenceBits); }
+
+    static constexpr OrderID sequenceOf(OrderID id) { return id & SequenceMask; }
+
+private:
+    std::uint32_t _partition;
+    OrderID       _lastSequence{0};
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+#include "order.hpp"
+
+// Open-addressing hash map from OrderID to a handle of where that order rests in the book.
+// Linear probing over a power-of-two table with backward-shift deletion, so there are no
+// tombstones and cancel-heavy flow doesn't degrade probe lengths over time.
+// OrderID 0 is never issued and marks an empty slot.
+template <typename Handle>
+class OrderIndex {
+public:
+    explicit OrderIndex(std::size_t expectedOrders = 1024) { rehash(capacityFor(expectedOrders)); }
+
+    [[nodiscard]] std::size_t size() const { return _size; }
+
+    [[nodiscard]] bool empty() const { return _size == 0; }
+
+    Handle* find(OrderID id) {
+        if (id == 0) return nullptr;        // would match the first empty slot
+        for (std::size_t i = home(id);; i = (i + 1) & _mask) {
+            if (_slots[i].id == id) return &_slots[i].handle;
+            if (_slots[i].id == 0)  return nullptr;
+        }
+    }
+
+    const Handle* find(OrderID id) const { return const_cast<OrderIndex*>(this)->find(id); }
+
+    // `id` must not already be present
+    void insert(OrderID id, const Handle& handle) {
+        if ((_size + 1) * 2 > _slots.size()) rehash(_slots.size() * 2);
+        std::size_t i = home(id);
+        while (_slots[i].id != 0) i = (i + 1) & _mask;
+        _slots[i] = Slot{id, handle};
+        ++_size;
+    }
+
+    bool erase(OrderID id) {
+        std::size_t i = home(id);
+        while (_slots[i].id != id) {
+            if (_slots[i].id == 0) return false;
+            i = (i + 1) & _mask;
+        }
+
+        // Backward-shift: pull later entries of the probe run into the hole if that
+        // doesn't move them before their home slot.
+        for (std::size_t j = (i + 1) & _mask; _slots[j].id != 0; j = (j + 1) & _mask) {
+            const std::size_t k = home(_slots[j].id);
+            if (((j - k) & _mask) >= ((j - i) & _mask)) {
+                _slots[i] = _slots[j];
+                i = j;
+            }
+        }
+        _slots[i] = Slot{};
+        --_size;
+        return true;
+    }
+
+    void clear() {
+        for (auto& slot : _slots) slot = Slot{};
+        _size = 0;
+    }
+
+private:
+    struct Slot {
+        OrderID id{0};
+        Handle  handle{};
+    };
+
+    static std::size_t capacityFor(std::size_t expectedOrders) {
+        std::size_t capacity = 16;
+        while (capacity < expectedOrders * 2) capacity *= 2;
+        return capacity;
+    }
+
+    // Fibonacci hashing: sequential ids spread evenly over the table
+    [[nodiscard]] std::size_t home(OrderID id) const {
+        return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> _shift);
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<Slot> old = std::move(_slots);
+        _slots.assign(capacity, Slot{});
+        _mask  = capacity - 1;
+        _shift = 64 - std::countr_zero(capacity);
+        _size  = 0;
+        for (const auto& slot : old) {
+            if (slot.id != 0) insert(slot.id, slot.handle);
+        }
+    }
+
+    std::vector<Slot> _slots;
+    std::size_t       _mask{0};
+    int               _shift{64};
+    std::size_t       _size{0};
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include "order.hpp"
+
+// Index of an order's node in an OrderPool. Stays valid for as long as the order rests.
+using PoolIndex = std::uint32_t;
+inline constexpr PoolIndex NullIndex = static_cast<PoolIndex>(-1);
+
+// What to do when every node is in use
+enum class PoolExhaustion {
+    REJECT,     // refuse the order; nothing is allocated after construction
+    GROW        // add another chunk of the same size (one allocation, existing nodes never move)
+};
+
+// Preallocated storage for resting orders. Nodes carry intrusive prev/next links, used by
+// PriceLevel for its FIFO queue while a node is in use and by the free list while it isn't,
+// so adding, filling and canceling orders never touches the heap.
+// Storage is a list of fixed-size chunks: growing adds a chunk and never relocates a node,
+// so PoolIndex values and Order references stay valid.
+class OrderPool {
+public:
+    struct Node {
+        union { Order order; };     // constructed only while the node is in use
+        PoolIndex prev{NullIndex};
+        PoolIndex next{NullIndex};
+
+        Node() {}
+    };
+
+    explicit OrderPool(std::size_t capacity = 1 << 16, PoolExhaustion onExhausted = PoolExhaustion::REJECT)
+            : _chunkSize(std::bit_ceil(std::max<std::size_t>(capacity, 64))),
+              _chunkShift(std::countr_zero(_chunkSize)),
+              _onExhausted(onExhausted) {
+        addChunk();
+    }
+
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    // NullIndex when the pool is full and the policy is REJECT
+    PoolIndex allocate(const Order& order) {
+        if (_free == NullIndex) {
+            if (_onExhausted == PoolExhaustion::REJECT) return NullIndex;
+            addChunk();
+        }
+        const PoolIndex index = _free;
+        Node& node = (*this)[index];
+        _free = node.next;
+        ::new (&node.order) Order(order);
+        node.prev = node.next = NullIndex;
+        ++_inUse;
+        return index;
+    }
+
+    void release(PoolIndex index) {
+        Node& node = (*this)[index];
+        node.prev = NullIndex;
+        node.next = _free;
+        _free = index;
+        --_inUse;
+    }
+
+    // Release every node at once (e.g. clearing the book for a new day)
+    void clear() {
+        _free = NullIndex;
+        for (std::size_t i = capacity(); i-- > 0;) {
+            Node& node = (*this)[static_cast<PoolIndex>(i)];
+            node.prev = NullIndex;
+            node.next = _free;
+            _free = static_cast<PoolIndex>(i);
+        }
+        _inUse = 0;
+    }
+
+    Node& operator[](PoolIndex index) { return _chunks[index >> _chunkShift][index & (_chunkSize - 1)]; }
+
+    const Node& operator[](PoolIndex index) const { return _chunks[index >> _chunkShift][index & (_chunkSize - 1)]; }
+
+    [[nodiscard]] std::size_t inUse() const { return _inUse; }
+
+    [[nodiscard]] std::size_t capacity() const { return _chunks.size() * _chunkSize; }
+
+    [[nodiscard]] PoolExhaustion exhaustionPolicy() const { return _onExhausted; }
+
+private:
+    void addChunk() {
+        const auto base = static_cast<PoolIndex>(capacity());
+        _chunks.push_back(std::make_unique<Node[]>(_chunkSize));
+        // thread the new nodes onto the free list, lowest index first
+        for (std::size_t i = _chunkSize; i-- > 0;) {
+            _chunks.back()[i].next = _free;
+            _free = base + static_cast<PoolIndex>(i);
+        }
+    }
+
+    std::vector<std::unique_ptr<Node[]>> _chunks;
+    std::size_t    _chunkSize;
+    int            _chunkShift;
+    PoolExhaustion _onExhausted;
+    PoolIndex      _free{NullIndex};
+    std::size_t    _inUse{0};
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <map>
+#include <functional>
+#include <type_traits>
+#include "side.hpp"
+#include "pricelevel.hpp"
+
+// One side of the book as ordered price levels, kept best-first:
+// bids from the highest price down, asks from the lowest price up.
+// Finding/creating a level is O(log L) in the number of levels, the best level is O(1).
+template <Side S>
+class MapLadder {
+public:
+    using Compare = std::conditional_t<S == Side::BUY, std::greater<Price>, std::less<Price>>;
+    using Levels  = std::map<Price, PriceLevel, Compare>;
+
+    [[nodiscard]] bool empty() const { return _levels.empty(); }
+
+    [[nodiscard]] std::size_t levelCount() const { return _levels.size(); }
+
+    PriceLevel* best() { return _levels.empty() ? nullptr : &_levels.begin()->second; }
+
+    PriceLevel* find(Price price) {
+        auto it = _levels.find(price);
+        return it == _levels.end() ? nullptr : &it->second;
+    }
+
+    // Level at `price`, created empty if it doesn't exist yet
+    PriceLevel& levelFor(Price price) {
+        auto [it, inserted] = _levels.try_emplace(price);
+        if (inserted) it->second.price = price;
+        return it->second;
+    }
+
+    void erase(Price price) { _levels.erase(price); }
+
+    void clear() { _levels.clear(); }
+
+    template <typename F>
+    void forEachBestFirst(F&& f) const {
+        for (const auto& [price, level] : _levels) f(level);
+    }
+
+    // Best level first while `f` returns true
+    template <typename F>
+    void forEachBestFirstWhile(F&& f) const {
+        for (const auto& [price, level] : _levels) if (!f(level)) return;
+    }
+
+    template <typename F>
+    void forEachWorstFirst(F&& f) const {
+        for (auto it = _levels.rbegin(); it != _levels.rend(); ++it) f(it->second);
+    }
+
+private:
+    Levels _levels;
+};
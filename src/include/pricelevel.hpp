@@ -0,0 +1,48 @@
+#pragma once
+#include "orderpool.hpp"
+
+// All resting orders at a single price, oldest first (time priority).
+// The queue is intrusive: the level only knows its head and tail, the links live in
+// the OrderPool nodes, so a level is a few words and any order can be unlinked in O(1).
+// The level also keeps its total open quantity and order count, updated on every
+// push / unlink / reduce, so depth questions never have to walk the orders.
+struct PriceLevel {
+    Price         price{};
+    Quantity      quantity{0};      // sum of the remaining quantity of its orders
+    PoolIndex     head{NullIndex};
+    PoolIndex     tail{NullIndex};
+    std::uint32_t orderCount{0};
+
+    [[nodiscard]] bool empty() const { return head == NullIndex; }
+
+    void push(OrderPool& pool, PoolIndex index) {
+        auto& node = pool[index];
+        quantity += node.order.getRemainingQuantity();
+        ++orderCount;
+        node.prev = tail;
+        node.next = NullIndex;
+        if (tail != NullIndex) pool[tail].next = index;
+        else                   head = index;
+        tail = index;
+    }
+
+    // Takes the order's remaining quantity out of the level total as well
+    void unlink(OrderPool& pool, PoolIndex index) {
+        auto& node = pool[index];
+        quantity -= node.order.getRemainingQuantity();
+        --orderCount;
+        if (node.prev != NullIndex) pool[node.prev].next = node.next;
+        else                        head = node.next;
+        if (node.next != NullIndex) pool[node.next].prev = node.prev;
+        else                        tail = node.prev;
+        node.prev = node.next = NullIndex;
+    }
+
+    // An order in the level had `by` taken off its remaining quantity (fill or in-place modify)
+    void reduce(Quantity by) { quantity -= by; }
+
+    template <typename F>
+    void forEachOrder(const OrderPool& pool, F&& f) const {
+        for (PoolIndex i = head; i != NullIndex; i = pool[i].next) f(pool[i].order);
+    }
+};
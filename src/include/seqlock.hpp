@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "cacheline.hpp"
+
+// Single-writer sequence lock around a trivially copyable value.
+// The writer never waits: it bumps the sequence to odd, stores the value, and bumps it back to
+// even. Readers never block the writer and never write shared memory; they copy the value and
+// retry if the sequence was odd or changed meanwhile. The value is kept as atomic words so the
+// concurrent copy is well defined, and a write costs sizeof(T) / 8 relaxed stores plus two.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock values are copied as plain words");
+
+public:
+    // Writer thread only
+    void store(const T& value) {
+        std::array<std::uint64_t, Words> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const std::uint64_t seq = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < Words; ++i) _words[i].store(words[i], std::memory_order_relaxed);
+        _sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Any thread. False if a write was in progress or happened during the copy.
+    bool tryLoad(T& out) const {
+        const std::uint64_t before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        std::array<std::uint64_t, Words> words;
+        for (std::size_t i = 0; i < Words; ++i) words[i] = _words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(static_cast<void*>(&out), words.data(), sizeof(T));
+        return true;
+    }
+
+    // Any thread. Retries until it gets a consistent copy.
+    T load() const {
+        T value;
+        while (!tryLoad(value)) {}
+        return value;
+    }
+
+    // Number of completed writes
+    [[nodiscard]] std::uint64_t version() const { return _sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t Words = (sizeof(T) + 7) / 8;
+
+    alignas(CacheLineSize) std::atomic<std::uint64_t>      _sequence{0};
+    std::array<std::atomic<std::uint64_t>, Words>          _words{};
+};
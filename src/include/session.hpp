@@ -0,0 +1,185 @@
+#pragma once
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+#include "execution.hpp"
+
+// Coroutine type of a client session run by a SessionLoop:
+//
+//     Session trader(SessionLoop<Orderbook>& loop) {
+//         ExecutionReport report = co_await loop.submit(request);
+//         if (report.restingQuantity > 0) co_await loop.cancel(report.orderId);
+//     }
+//
+// A session starts suspended and only runs inside SessionLoop::run(). Exceptions escaping a
+// session propagate out of run().
+class Session {
+public:
+    struct promise_type {
+        Session get_return_object() { return Session(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+    };
+
+    Session(Session&& other) noexcept : _handle(std::exchange(other._handle, {})) {}
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    ~Session() { if (_handle) _handle.destroy(); }
+
+    // Hand the coroutine over (to the loop)
+    std::coroutine_handle<promise_type> release() { return std::exchange(_handle, {}); }
+
+private:
+    explicit Session(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+// Runs many client sessions on one thread against one book.
+// A session that awaits submit() / cancel() is parked; once every runnable session has had its
+// turn, the loop applies all parked operations to the book in the order they were awaited
+// (consecutive submits go through one submitBatch) and makes their sessions runnable again
+// with the results. Each session costs one coroutine frame, so a single thread drives as many
+// sessions as fit in memory, and a round of them shares one sink flush.
+template <typename Book>
+class SessionLoop {
+public:
+    explicit SessionLoop(Book& book) : _book(book) {}
+
+    SessionLoop(const SessionLoop&) = delete;
+    SessionLoop& operator=(const SessionLoop&) = delete;
+
+    // Every unfinished session is either runnable or parked; destroy those left if run() threw
+    ~SessionLoop() {
+        for (auto handle : _runnable) handle.destroy();
+        for (const auto& parked : _parked) parked.waiter.destroy();
+    }
+
+    // Schedule a session; it first runs on the next run()
+    void spawn(Session session) {
+        _runnable.push_back(session.release());
+        ++_live;
+    }
+
+    // Until every spawned session has finished
+    void run() {
+        while (!_runnable.empty() || !_parked.empty()) {
+            while (!_runnable.empty()) {
+                const std::coroutine_handle<> next = _runnable.front();
+                _runnable.pop_front();
+                try {
+                    next.resume();
+                } catch (...) {
+                    next.destroy();         // a session that threw is done
+                    --_live;
+                    throw;
+                }
+                if (next.done()) {
+                    next.destroy();
+                    --_live;
+                }
+            }
+            applyParked();
+        }
+    }
+
+    [[nodiscard]] std::size_t liveSessions() const { return _live; }
+
+    // Operations completed by the book so far
+    [[nodiscard]] std::uint64_t operationsCompleted() const { return _completed; }
+
+    // co_await: the ExecutionReport of `request` once the loop has matched it
+    auto submit(const OrderRequest& request) {
+        struct Awaiter {
+            SessionLoop&    loop;
+            OrderRequest    request;
+            ExecutionReport report{};
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> waiter) {
+                loop._parked.push_back(Parked{Parked::Kind::SUBMIT, waiter, &request, &report, 0, nullptr});
+            }
+            ExecutionReport await_resume() { return std::move(report); }
+        };
+        return Awaiter{*this, request};
+    }
+
+    // co_await: whether the resting order was found and canceled
+    auto cancel(OrderID orderId) {
+        struct Awaiter {
+            SessionLoop& loop;
+            OrderID      orderId;
+            bool         canceled{false};
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> waiter) {
+                loop._parked.push_back(Parked{Parked::Kind::CANCEL, waiter, nullptr, nullptr, orderId, &canceled});
+            }
+            bool await_resume() const { return canceled; }
+        };
+        return Awaiter{*this, orderId};
+    }
+
+    // co_await: let every other runnable session go first
+    auto yield() {
+        struct Awaiter {
+            SessionLoop& loop;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> waiter) { loop._runnable.push_back(waiter); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+private:
+    // An awaited operation; the pointers refer into the suspended session's awaiter
+    struct Parked {
+        enum class Kind : std::uint8_t { SUBMIT, CANCEL };
+
+        Kind                    kind;
+        std::coroutine_handle<> waiter;
+        const OrderRequest*     request;    // SUBMIT
+        ExecutionReport*        report;     // SUBMIT
+        OrderID                 orderId;    // CANCEL
+        bool*                   canceled;   // CANCEL
+    };
+
+    void applyParked() {
+        std::swap(_parked, _applying);      // sessions resumed below may park again
+        for (std::size_t i = 0; i < _applying.size();) {
+            if (_applying[i].kind == Parked::Kind::CANCEL) {
+                *_applying[i].canceled = _book.cancel(_applying[i].orderId);
+                ++i;
+                continue;
+            }
+            std::size_t end = i;
+            _requests.clear();
+            while (end < _applying.size() && _applying[end].kind == Parked::Kind::SUBMIT) {
+                _requests.push_back(*_applying[end].request);
+                ++end;
+            }
+            if (_reports.size() < _requests.size()) _reports.resize(_requests.size());
+            _book.submitBatch(_requests, _reports);
+            for (std::size_t j = i; j < end; ++j) std::swap(*_applying[j].report, _reports[j - i]);
+            i = end;
+        }
+        for (const auto& parked : _applying) _runnable.push_back(parked.waiter);
+        _completed += _applying.size();
+        _applying.clear();
+    }
+
+    Book&                                               _book;
+    std::deque<std::coroutine_handle<>>                 _runnable;
+    std::vector<Parked>                                 _parked;
+    std::vector<Parked>                                 _applying;
+    std::vector<OrderRequest>                           _requests;
+    std::vector<ExecutionReport>                        _reports;       // reused, fill storage circulates
+    std::size_t                                         _live{0};
+    std::uint64_t                                       _completed{0};
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "orderbook.hpp"
+#include "workstealingpool.hpp"
+
+// Research runs: seeds x symbols independent paths, each simulating `days` consecutive days
+// (populate -> order flow -> close) on its own book. A path draws every random number from
+// its own generator, seeded from (seed, symbol), so its result is the same whichever thread
+// runs it and in whatever order.
+struct SimulationConfig {
+    std::uint64_t firstSeed{0};             // paths use seeds firstSeed .. firstSeed + seeds - 1
+    std::uint64_t seeds{8};
+    std::uint32_t symbols{16};
+    std::size_t   days{20};
+    std::size_t   ordersPerDay{10'000};
+    Price         openingPrice{10'000};     // ticks
+};
+
+// Outcome of one path after its last day
+struct PathResult {
+    std::uint64_t seed{0};
+    std::uint32_t symbol{0};
+    Price         closePrice{0};            // last trade of the last day (or its opening price)
+    Quantity      volume{0};                // shares traded over all days
+    std::uint64_t trades{0};                // fills over all days
+};
+
+struct SimulationSummary {
+    std::vector<PathResult> paths;          // ordered by (seed, symbol)
+    std::size_t             days{0};        // simulated days over all paths
+    double                  seconds{0};
+
+    [[nodiscard]] double daysPerSecond() const { return seconds > 0 ? static_cast<double>(days) / seconds : 0.0; }
+
+    [[nodiscard]] Quantity totalVolume() const {
+        Quantity total = 0;
+        for (const auto& path : paths) total += path.volume;
+        return total;
+    }
+
+    [[nodiscard]] double meanClosePrice() const {
+        if (paths.empty()) return 0.0;
+        double total = 0;
+        for (const auto& path : paths) total += static_cast<double>(path.closePrice);
+        return total / static_cast<double>(paths.size());
+    }
+};
+
+// Generator seed of one path: SplitMix64 of (seed, symbol), so neighbouring paths are unrelated
+inline std::uint64_t pathSeed(std::uint64_t seed, std::uint32_t symbol) {
+    std::uint64_t z = seed * 0x9E3779B97F4A7C15ull + symbol + 1;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+template <typename Backend = DenseBackend<>>
+PathResult simulatePath(const SimulationConfig& config, std::uint64_t seed, std::uint32_t symbol) {
+    std::mt19937_64 rng(pathSeed(seed, symbol));
+    std::uniform_int_distribution<int> pct(0, 99);
+    std::uniform_int_distribution<Price> offset(-20, 20);
+    std::uniform_int_distribution<Quantity> qty(1, 500);
+
+    BookConfig bookConfig;
+    bookConfig.orderCapacity = config.ordersPerDay;
+    bookConfig.onPoolExhausted = PoolExhaustion::GROW;
+    BasicOrderbook<Backend, NullSink> book(bookConfig);
+
+    PathResult result{seed, symbol, config.openingPrice};
+    ExecutionReport report;
+    for (std::size_t day = 0; day < config.days; ++day) {
+        book.simulateNextDay(result.closePrice, rng);
+        const Price open = book.getTodaysPrice();
+        Price last = open;
+
+        for (std::size_t i = 0; i < config.ordersPerDay; ++i) {
+            const Side side = (rng() & 1) ? Side::BUY : Side::SELL;
+            OrderRequest request{side, OrderType::LIMIT, TimeInForce::GOOD_TILL_CANCEL, std::max<Price>(1, open + offset(rng)), qty(rng)};
+            if (pct(rng) < 10) {
+                request.type = OrderType::MARKET;
+                request.timeInForce = TimeInForce::IMMEDIATE_OR_CANCEL;
+            }
+            book.submit(request, report);
+            if (!report.fills.empty()) last = report.fills.back().price;
+            result.volume += report.filledQuantity;
+            result.trades += report.fills.size();
+        }
+        result.closePrice = last;
+    }
+    return result;
+}
+
+// Runs every path of `config` as one task on `pool` and gathers the results
+template <typename Backend = DenseBackend<>>
+SimulationSummary runSimulation(const SimulationConfig& config, WorkStealingPool& pool) {
+    SimulationSummary summary;
+    summary.paths.resize(config.seeds * config.symbols);
+    summary.days = summary.paths.size() * config.days;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < config.seeds; ++i) {
+        const std::uint64_t seed = config.firstSeed + i;
+        for (std::uint32_t symbol = 0; symbol < config.symbols; ++symbol) {
+            PathResult& slot = summary.paths[i * config.symbols + symbol];
+            pool.submit([&config, &slot, seed, symbol] { slot = simulatePath<Backend>(config, seed, symbol); });
+        }
+    }
+    pool.wait();
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
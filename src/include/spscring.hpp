@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include "cacheline.hpp"
+
+// Bounded single-producer / single-consumer ring of trivially copyable items.
+// One thread may push and one (other) thread may pop; neither ever locks or allocates.
+// Head and tail live on their own cache lines, and each side keeps a cached copy of the other
+// side's index so it only reads the shared one when the ring looks full / empty.
+// The batch calls copy as many items as fit and publish them with a single store.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(std::has_single_bit(Capacity), "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing items are copied as plain bytes");
+
+public:
+    // Producer side
+
+    bool tryPush(const T& item) { return pushBatch(std::span<const T>(&item, 1)) == 1; }
+
+    // Pushes a prefix of `items`, returns how many
+    std::size_t pushBatch(std::span<const T> items) {
+        const std::uint64_t head = _head.load(std::memory_order_relaxed);
+        std::size_t room = Capacity - static_cast<std::size_t>(head - _cachedTail);
+        if (room < items.size()) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            room = Capacity - static_cast<std::size_t>(head - _cachedTail);
+        }
+        const std::size_t n = std::min(room, items.size());
+        for (std::size_t i = 0; i < n; ++i) _slots[(head + i) & Mask] = items[i];
+        if (n) _head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side
+
+    bool tryPop(T& item) { return popBatch(std::span<T>(&item, 1)) == 1; }
+
+    // Pops up to out.size() items into `out`, returns how many
+    std::size_t popBatch(std::span<T> out) {
+        const std::uint64_t tail = _tail.load(std::memory_order_relaxed);
+        std::size_t available = static_cast<std::size_t>(_cachedHead - tail);
+        if (available < out.size()) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            available = static_cast<std::size_t>(_cachedHead - tail);
+        }
+        const std::size_t n = std::min(available, out.size());
+        for (std::size_t i = 0; i < n; ++i) out[i] = _slots[(tail + i) & Mask];
+        if (n) _tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Either side; exact only when the other side is idle
+    [[nodiscard]] bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::uint64_t Mask = Capacity - 1;
+
+    alignas(CacheLineSize) std::atomic<std::uint64_t> _head{0};     // next slot to write
+    std::uint64_t                                     _cachedTail{0}; // producer's view of _tail
+    alignas(CacheLineSize) std::atomic<std::uint64_t> _tail{0};     // next slot to read
+    std::uint64_t                                     _cachedHead{0}; // consumer's view of _head
+    alignas(CacheLineSize) std::array<T, Capacity>    _slots{};
+};
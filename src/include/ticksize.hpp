@@ -0,0 +1,51 @@
+#pragma once
+#include <cmath>
+#include <stdexcept>
+#include "order.hpp"
+
+// How a decimal price that doesn't land exactly on a tick is turned into ticks
+enum class TickRounding {
+    NEAREST,        // closest tick
+    CONSERVATIVE,   // buys round down, sells round up: never more aggressive than requested
+    REJECT          // off-tick prices are an error
+};
+
+// Converts between decimal prices (what users type and see) and integer ticks (what the book stores).
+class TickSize {
+public:
+    constexpr explicit TickSize(double tick = 0.01, TickRounding rounding = TickRounding::NEAREST)
+            : _tick(tick), _rounding(rounding) {}
+
+    [[nodiscard]] Price toTicks(double price, Side side) const {
+        if (_tick <= 0) throw std::invalid_argument("Tick size must be > 0");
+        const double ticks = price / _tick;
+        const double nearest = std::round(ticks);
+        // tolerate binary floating point noise, e.g. 100.07 / 0.01 = 10006.999999999998
+        if (std::abs(ticks - nearest) < 1e-6) return static_cast<Price>(nearest);
+
+        switch (_rounding) {
+            case TickRounding::NEAREST:
+                return static_cast<Price>(nearest);
+            case TickRounding::CONSERVATIVE:
+                return static_cast<Price>(side == Side::BUY ? std::floor(ticks) : std::ceil(ticks));
+            case TickRounding::REJECT:
+                break;
+        }
+        throw std::invalid_argument("Price is not a multiple of the tick size");
+    }
+
+    // Reference prices (today's price etc.) aren't orders, so they always take the closest tick
+    [[nodiscard]] Price nearestTicks(double price) const {
+        return static_cast<Price>(std::llround(price / _tick));
+    }
+
+    [[nodiscard]] double toDouble(Price ticks) const { return static_cast<double>(ticks) * _tick; }
+
+    [[nodiscard]] double tick() const { return _tick; }
+
+    [[nodiscard]] TickRounding rounding() const { return _rounding; }
+
+private:
+    double       _tick;
+    TickRounding _rounding;
+};
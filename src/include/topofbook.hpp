@@ -0,0 +1,18 @@
+#pragma once
+#include "pricelevel.hpp"
+
+// The best level of one side of the book: price, open quantity and order count.
+// The book refreshes it whenever that side changes, so reading it never touches the ladder.
+struct TopOfBook {
+    Price         price{0};
+    Quantity      quantity{0};
+    std::uint32_t orderCount{0};
+
+    [[nodiscard]] bool empty() const { return orderCount == 0; }
+
+    // Snapshot of `level`, or an empty top if the side has no levels
+    static TopOfBook of(const PriceLevel* level) {
+        if (level == nullptr) return TopOfBook{};
+        return TopOfBook{level->price, level->quantity, level->orderCount};
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "cacheline.hpp"
+
+// How a consumer thread waits when its queue is empty. Lower latency costs more CPU:
+enum class WaitStrategy {
+    BUSY_SPIN,      // spin with a pause instruction, never gives up the core (dedicated cores only)
+    SPIN_YIELD,     // spin for a while, then yield the core to other threads between polls
+    SPIN_PARK,      // spin for a while, then sleep on a futex until a producer rings
+    BLOCKING        // sleep on the futex as soon as the queue is empty
+};
+
+// Tell the core we are spinning (lets the sibling hyperthread run, saves power)
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// The waiting half of a consumer loop, plus the doorbell producers ring to wake it.
+// Producers only pay for a wake-up (a fence, and a futex call if the consumer is asleep)
+// under the parking strategies; spinning consumers find new work by polling.
+class IdleWaiter {
+public:
+    static constexpr std::uint32_t SpinLimit = 4096;    // polls before yielding / parking
+
+    explicit IdleWaiter(WaitStrategy strategy = WaitStrategy::SPIN_YIELD) : _strategy(strategy) {}
+
+    [[nodiscard]] WaitStrategy strategy() const { return _strategy; }
+
+    // Consumer: nothing to do this poll. `hasWork` is checked again after announcing that we
+    // are about to sleep, so a producer that published just before can't be missed.
+    template <typename F>
+    void idle(F&& hasWork) {
+        switch (_strategy) {
+            case WaitStrategy::BUSY_SPIN:
+                cpuRelax();
+                return;
+            case WaitStrategy::SPIN_YIELD:
+                if (++_idlePolls < SpinLimit) cpuRelax();
+                else                          std::this_thread::yield();
+                return;
+            case WaitStrategy::SPIN_PARK:
+                if (++_idlePolls < SpinLimit) {
+                    cpuRelax();
+                    return;
+                }
+                break;
+            case WaitStrategy::BLOCKING:
+                break;
+        }
+        const std::uint32_t rung = _doorbell.load(std::memory_order_acquire);
+        _sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!hasWork()) _doorbell.wait(rung, std::memory_order_acquire);
+        _sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // Consumer: found work, start the spin phase over next time
+    void busy() { _idlePolls = 0; }
+
+    // Producer: after publishing work
+    void notify() {
+        if (_strategy != WaitStrategy::SPIN_PARK && _strategy != WaitStrategy::BLOCKING) return;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleeping.load(std::memory_order_relaxed)) ring();
+    }
+
+    // Wake the consumer whatever it is doing (e.g. to stop it)
+    void ring() {
+        _doorbell.fetch_add(1, std::memory_order_release);
+        _doorbell.notify_all();
+    }
+
+private:
+    WaitStrategy                                      _strategy;
+    std::uint32_t                                     _idlePolls{0};      // consumer only
+    alignas(CacheLineSize) std::atomic<std::uint32_t> _doorbell{0};
+    std::atomic<bool>                                 _sleeping{false};
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cpuaffinity.hpp"
+
+// Thread pool where every worker has its own task deque.
+// A worker takes its newest task from the back of its own deque (good locality for tasks it
+// spawned itself) and, when that is empty, steals the oldest task from the front of another
+// worker's deque, so uneven tasks even out without a central queue every thread contends on.
+// Each deque has its own small lock, held only to push or pop one task.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(std::size_t threads = cpuCount()) {
+        if (threads == 0) threads = 1;
+        _workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) _workers.push_back(std::make_unique<Worker>());
+        for (std::size_t i = 0; i < threads; ++i) {
+            _workers[i]->thread = std::jthread([this, i](std::stop_token stop) { work(i, stop); });
+        }
+    }
+
+    // Unstarted tasks are dropped; call wait() first to finish them
+    ~WorkStealingPool() {
+        for (auto& worker : _workers) worker->thread.request_stop();
+        _wake.notify_all();
+        for (auto& worker : _workers) worker->thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // From a task: onto the calling worker's own deque. From outside: round-robin over workers.
+    void submit(Task task) {
+        const std::size_t target = (tlsPool == this) ? tlsWorker
+                                                     : _nextWorker.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+        _pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            // Counted before it is pushed so the count never drops below zero, and under the
+            // wake lock so a worker can't miss it between checking and going to sleep
+            std::lock_guard lock(_wakeMutex);
+            _queued.fetch_add(1, std::memory_order_release);
+        }
+        {
+            std::lock_guard lock(_workers[target]->mutex);
+            _workers[target]->tasks.push_back(std::move(task));
+        }
+        _wake.notify_one();
+    }
+
+    // Until every submitted task (including ones submitted by tasks) has run.
+    // Rethrows the first exception a task threw.
+    void wait() {
+        for (std::size_t pending = _pending.load(std::memory_order_acquire); pending != 0;
+             pending = _pending.load(std::memory_order_acquire)) {
+            _pending.wait(pending, std::memory_order_acquire);
+        }
+        std::lock_guard lock(_errorMutex);
+        if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+    }
+
+    [[nodiscard]] std::size_t threadCount() const { return _workers.size(); }
+
+    // Tasks run by a worker other than the one they were queued on
+    [[nodiscard]] std::uint64_t steals() const { return _steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex        mutex;
+        std::deque<Task>  tasks;
+        std::jthread      thread;
+    };
+
+    void work(std::size_t self, std::stop_token stop) {
+        tlsPool = this;
+        tlsWorker = self;
+        Task task;
+        while (!stop.stop_requested()) {
+            if (popOwn(self, task) || steal(self, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock lock(_wakeMutex);
+            _wake.wait(lock, stop, [this] { return _queued.load(std::memory_order_acquire) > 0; });
+        }
+    }
+
+    bool popOwn(std::size_t self, Task& task) {
+        Worker& worker = *_workers[self];
+        std::lock_guard lock(worker.mutex);
+        if (worker.tasks.empty()) return false;
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(std::size_t self, Task& task) {
+        for (std::size_t k = 1; k < _workers.size(); ++k) {
+            Worker& victim = *_workers[(self + k) % _workers.size()];
+            std::lock_guard lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            _steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void run(Task& task) {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard lock(_errorMutex);
+            if (!_error) _error = std::current_exception();
+        }
+        task = nullptr;
+        if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) _pending.notify_all();
+    }
+
+    inline static thread_local WorkStealingPool* tlsPool = nullptr;
+    inline static thread_local std::size_t       tlsWorker = 0;
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<std::size_t>             _nextWorker{0};
+    std::atomic<std::size_t>             _queued{0};     // tasks sitting in deques
+    std::atomic<std::size_t>             _pending{0};    // submitted and not yet finished
+    std::atomic<std::uint64_t>           _steals{0};
+    std::mutex                           _wakeMutex;
+    std::condition_variable_any          _wake;
+    std::mutex                           _errorMutex;
+    std::exception_ptr                   _error;
+};
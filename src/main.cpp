@@ -1,15 +1,260 @@
 #include <iostream>
+#include <filesystem>
 #include <format>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
 #include "include/order.hpp"
 #include "include/choice.hpp"
 #include "include/orderbook.hpp"
+#include "include/journal.hpp"
+#include "include/booksnapshot.hpp"
+#include "include/bookloader.hpp"
+#include "include/corelayout.hpp"
 
 using Day = int32_t;
 
-int main() {
+// The interactive menu is a thin client of the headless Orderbook::submit / cancel / modify API:
+// it collects an OrderRequest from std::cin, the ConsoleSink prints every fill / rest / cancel as
+// it happens, and the client prints a summary line from the ExecutionReport it gets back.
+// With --journal, every outcome is also journaled, the book is snapshotted at the start of each
+// simulated day, and a restart rebuilds it from the latest snapshot plus the journal after it.
+using InteractiveOrderbook = BasicOrderbook<MapBackend, TeeSink<ConsoleSink, JournalSink>>;
 
-    Orderbook orderbook;
-    orderbook.populateOrderbook(100);
+void printReport(const InteractiveOrderbook& orderbook, Side side, const ExecutionReport& report) {
+    const TickSize& ticks = orderbook.getTickSize();
+
+    // Nothing executed: the sink already said why (rested, canceled or rejected)
+    if (report.filledQuantity == 0) return;
+
+    std::cout << (side == Side::BUY ? "BUY " : "SELL ")
+              << report.filledQuantity << " shares"
+              << (report.status == OrderStatus::FILLED ? " (FULL)" : " (PARTIAL)")
+              << " @ VWAP $" << ticks.tick() * report.vwap()
+              << " | Notional $" << ticks.toDouble(report.notional)
+              << (report.restingQuantity > 0 ? " | Remainder rested on book" : "")
+              << "\n";
+}
+
+// Reads B/S, returns false on anything else
+bool readSide(const char* prompt, Side& side) {
+    char buyOrSell{};
+    std::cout << prompt;
+    std::cin >> buyOrSell;
+    buyOrSell = static_cast<char>(std::toupper(static_cast<unsigned char>(buyOrSell)));
+    if (buyOrSell != 'B' && buyOrSell != 'S') {
+        std::cout << "Invalid side.\n";
+        return false;
+    }
+    side = (buyOrSell == 'B') ? Side::BUY : Side::SELL;
+    return true;
+}
+
+// Reads a decimal price and converts it to ticks with the book's rounding rule
+bool readPrice(const InteractiveOrderbook& orderbook, const char* prompt, Side side, Price& price) {
+    double limitPrice{};
+    std::cout << prompt;
+    std::cin >> limitPrice;
+    if (limitPrice <= 0.0) {
+        std::cout << "Price must be > 0.\n";
+        return false;
+    }
+    try {
+        price = orderbook.getTickSize().toTicks(limitPrice, side);
+    } catch (const std::exception& ex) {
+        std::cout << ex.what() << " (" << orderbook.getTickSize().tick() << ").\n";
+        return false;
+    }
+    if (price <= 0) {
+        std::cout << "Price must be at least one tick.\n";
+        return false;
+    }
+    return true;
+}
+
+void executeMarketOrder(InteractiveOrderbook& orderbook, const Portfolio& portfolio) {
+    (void)portfolio;    // affordability / inventory checks would go here
+
+    OrderRequest request{};
+    request.type = OrderType::MARKET;
+
+    // determine if user wants buy or sell
+    if (!readSide("Do you want to buy or sell? (B=BUY, S=SELL): ", request.side)) return;
+
+    // inquiry about time restrictions (for MARKET orders, use FOK or IOC)
+    int timeInForce{};
+    std::cout << "Do you want\n"
+                 "1. Fill or Kill\n"
+                 "2. Immediate or Cancel\n";
+    std::cin >> timeInForce;
+    if (timeInForce != 1 && timeInForce != 2) {
+        std::cout << "Invalid time-in-force choice.\n";
+        return;
+    }
+    request.timeInForce = (timeInForce == 1) ? TimeInForce::FILL_OR_KILL : TimeInForce::IMMEDIATE_OR_CANCEL;
+
+    // enter quantity
+    std::cout << "What quantity do you want: ";
+    std::cin >> request.quantity;
+    if (request.quantity <= 0) {
+        std::cout << "Quantity must be > 0.\n";
+        return;
+    }
+
+    const ExecutionReport report = orderbook.submit(request);
+    if (report.orderId != 0) {
+        std::cout << "Created order id " << report.orderId
+                  << " | " << ((request.side == Side::BUY) ? "BUY" : "SELL")
+                  << " " << request.quantity
+                  << " @ MKT"
+                  << " | Time In Force=" << ((request.timeInForce == TimeInForce::FILL_OR_KILL) ? "Fill Or Kill" : "Immediate or Cancel")
+                  << "\n";
+    }
+    printReport(orderbook, request.side, report);
+}
+
+void executeLimitOrder(InteractiveOrderbook& orderbook) {
+    OrderRequest request{};
+    request.type = OrderType::LIMIT;
+
+    // Side
+    if (!readSide("Limit order: Do you want to buy or sell? (B=BUY, S=SELL): ", request.side)) return;
+
+    // Time-in-force (for LIMIT: GTC or FOK)
+    int tifChoice{};
+    std::cout << "Time In Force\n"
+                 "1. Good Till Cancel (GTC)\n"
+                 "2. Fill or Kill (FOK)\n"
+                 "Choose: ";
+    std::cin >> tifChoice;
+    if (tifChoice != 1 && tifChoice != 2) {
+        std::cout << "Invalid TIF choice.\n";
+        return;
+    }
+    request.timeInForce = (tifChoice == 1) ? TimeInForce::GOOD_TILL_CANCEL
+                                           : TimeInForce::FILL_OR_KILL;
+
+    // Price, converted to ticks using this book's rounding rule
+    if (!readPrice(orderbook, "Limit Price: ", request.side, request.price)) return;
+
+    // Quantity
+    std::cout << "Quantity: ";
+    std::cin >> request.quantity;
+    if (request.quantity <= 0) {
+        std::cout << "Quantity must be > 0.\n";
+        return;
+    }
+
+    const ExecutionReport report = orderbook.submit(request);
+    std::cout << "Created LIMIT order id " << report.orderId
+              << " | " << ((request.side == Side::BUY) ? "BUY" : "SELL")
+              << " " << request.quantity << " @ $" << orderbook.getTickSize().toDouble(request.price)
+              << " | TIF=" << ((request.timeInForce == TimeInForce::GOOD_TILL_CANCEL) ? "GTC" : "FOK") << "\n";
+    printReport(orderbook, request.side, report);
+}
+
+void executeCancelOrder(InteractiveOrderbook& orderbook) {
+    OrderID orderId{};
+    std::cout << "Order id to cancel: ";
+    std::cin >> orderId;
+    if (!orderbook.cancel(orderId)) std::cout << "Order " << orderId << " is not resting on the book.\n";
+}
+
+void executeModifyOrder(InteractiveOrderbook& orderbook) {
+    OrderID orderId{};
+    std::cout << "Order id to modify: ";
+    std::cin >> orderId;
+    const Order* resting = orderbook.findOrder(orderId);
+    if (resting == nullptr) {
+        std::cout << "Order " << orderId << " is not resting on the book.\n";
+        return;
+    }
+    const Side side = resting->getSide();
+
+    Price price{};
+    if (!readPrice(orderbook, "New Limit Price: ", side, price)) return;
+
+    Quantity quantity{};
+    std::cout << "New Quantity: ";
+    std::cin >> quantity;
+
+    ExecutionReport replacement;
+    if (!orderbook.modify(orderId, quantity, price, &replacement)) {
+        std::cout << "Quantity must be > 0.\n";
+        return;
+    }
+    if (replacement.orderId != 0) printReport(orderbook, side, replacement);
+}
+
+// Value of `--name value`, or nullptr if the flag isn't given
+const char* readFlag(int argc, char** argv, std::string_view name) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) != name) continue;
+        if (i + 1 == argc) throw std::invalid_argument(std::string(name) + " needs a value");
+        return argv[i + 1];
+    }
+    return nullptr;
+}
+
+// --seed N replays the synthetic days of an earlier run; without it a fresh seed is drawn
+std::uint64_t readSeed(int argc, char** argv) {
+    if (const char* seed = readFlag(argc, argv, "--seed")) return std::stoull(seed);
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+}
+
+int main(int argc, char** argv) {
+
+    BookConfig config;
+    std::unique_ptr<Journal> journal;
+    std::unique_ptr<OpeningBookFile> openingBook;
+    CoreLayout layout;
+    try {
+        config.seed = readSeed(argc, argv);
+        // --journal PATH: resting orders survive a crash or restart
+        if (const char* path = readFlag(argc, argv, "--journal")) journal = std::make_unique<Journal>(path);
+        // --book PATH: the first day opens on this book (CSV or binary, see bookloader.hpp)
+        if (const char* path = readFlag(argc, argv, "--book")) {
+            openingBook = std::make_unique<OpeningBookFile>(path, config.tickSize);
+            config.orderCapacity = std::max(config.orderCapacity, openingBook->orders().size());
+        }
+        // --cores SPEC (see corelayout.hpp): this thread runs the book on the first matching CPU,
+        // the snapshot writer on the journal CPUs
+        if (const char* spec = readFlag(argc, argv, "--cores")) layout = CoreLayout::parse(spec);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+    std::cout << "Seed: " << config.seed << " (--seed " << config.seed << " replays these days)\n";
+    if (!layout.empty()) {
+        const ThreadPlacement placements[] = {layout.apply(ThreadRole::MATCHING, 0)};
+        printLayout(std::cout, placements);
+    }
+
+    InteractiveOrderbook orderbook(config, TeeSink(ConsoleSink{}, JournalSink(journal.get())));
+    std::unique_ptr<BookSnapshotter<InteractiveOrderbook>> snapshotter;
+    if (journal) snapshotter = std::make_unique<BookSnapshotter<InteractiveOrderbook>>(orderbook, *journal, journal->path() + ".snapshot", layout.journal);
+
+    if (journal && (journal->size() > 0 || std::filesystem::exists(snapshotter->path()))) {
+        const std::size_t replayed = recoverBook(orderbook, snapshotter->path(), *journal);
+        std::cout << "Restored the book (" << replayed << " journaled events after the latest snapshot). Today's Price: "
+                  << orderbook.getTickSize().toDouble(orderbook.getTodaysPrice()) << "\n";
+    } else if (openingBook) {
+        try {
+            orderbook.getSink().first().showRests(false);
+            const std::size_t loaded = orderbook.loadOpeningBook(openingBook->orders(), openingBook->todaysPrice());
+            orderbook.getSink().first().showRests(true);
+            std::cout << "Loaded " << loaded << " orders. Today's Price: "
+                      << orderbook.getTickSize().toDouble(orderbook.getTodaysPrice()) << "\n";
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << "\n";
+            return 1;
+        }
+        openingBook.reset();
+    } else {
+        orderbook.populateOrderbook(orderbook.getTickSize().nearestTicks(100.0));
+    }
 
     Portfolio portfolio;
     portfolio.setBalance(10000);
@@ -26,27 +271,38 @@ int main() {
                                  "2. Limit Buy/Sell\n"
                                  "3. Simulate Day\n"
                                  "4. Display Orderbook\n"
-                                 "5. Exit\n"
+                                 "5. Cancel Order\n"
+                                 "6. Modify Order\n"
+                                 "7. Exit\n"
                                  "Enter choice: ",
                                  day);
 
         std::cin >> choice;
+        if (snapshotter) snapshotter->poll();
 
         switch (choice) {
             case Choice::MARKET:
-                orderbook.executeMarketOrder(portfolio);
+                executeMarketOrder(orderbook, portfolio);
                 break;
             case Choice::LIMIT:
-                orderbook.executeLimitOrder();
+                executeLimitOrder(orderbook);
                 break;
             case Choice::SIMULATE_DAY:
                 orderbook.simulateNextDay(orderbook.getTodaysPrice());
+                if (snapshotter) snapshotter->snapshot();   // yesterday's journal is no longer needed
                 day++;
                 break;
             case Choice::DISPLAY_ORDERBOOK:
                 orderbook.displayOrderbook();
                 break;
+            case Choice::CANCEL_ORDER:
+                executeCancelOrder(orderbook);
+                break;
+            case Choice::MODIFY_ORDER:
+                executeModifyOrder(orderbook);
+                break;
             case Choice::EXIT:
+                if (snapshotter) snapshotter->finish();
                 keep_trading = false;
                 break;
             default: